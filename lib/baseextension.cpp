@@ -41,30 +41,29 @@ QString BaseExtension::handleSynchronousCall(const QString& funcName, const QJso
     return QString("");
 }
 
-void BaseExtension::callback(int id, const QString &parameters)
+static QString buildCallbackScript(const char *function, int id, const QString &parameters)
 {
     QString script;
+    script.reserve(qstrlen(function) + parameters.length() + 16);
 
+    script.append(QLatin1String(function));
+    script.append('(');
+    script.append(QString::number(id));
     if (parameters.length() > 0) {
-        script = QString("_webOS.callback(%1, %2);").arg(id).arg(parameters);
-    }
-    else {
-        script = QString("_webOS.callback(%1);").arg(id);
+        script.append(QLatin1String(", "));
+        script.append(parameters);
     }
+    script.append(QLatin1String(");"));
 
-    mAppEnvironment->executeScript(script);
+    return script;
 }
 
-void BaseExtension::callbackWithoutRemove(int id, const QString &parameters)
+void BaseExtension::callback(int id, const QString &parameters)
 {
-    QString script;
-
-    if (parameters.length() > 0) {
-        script = QString("_webOS.callbackWithoutRemove(%1, %2);").arg(id).arg(parameters);
-    }
-    else {
-        script = QString("_webOS.callbackWithoutRemove(%1);").arg(id);
-    }
+    mAppEnvironment->executeScript(buildCallbackScript("_webOS.callback", id, parameters));
+}
 
-    mAppEnvironment->executeScript(script);
+void BaseExtension::callbackWithoutRemove(int id, const QString &parameters)
+{
+    mAppEnvironment->executeScript(buildCallbackScript("_webOS.callbackWithoutRemove", id, parameters));
 }
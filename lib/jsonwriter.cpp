@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QJsonArray>
+#include <QJsonObject>
+
+#include <math.h>
+
+#include "jsonwriter.h"
+
+namespace luna
+{
+
+JsonWriter::JsonWriter(int reserve)
+{
+    mBuffer.reserve(reserve);
+}
+
+void JsonWriter::clear()
+{
+    // resize keeps the reserved capacity while clear would release it
+    mBuffer.resize(0);
+    mEmpty.clear();
+}
+
+void JsonWriter::beginObject()
+{
+    separate();
+    mBuffer.append('{');
+    mEmpty.append(true);
+}
+
+void JsonWriter::beginObject(const char *key)
+{
+    writeKey(key);
+    mBuffer.append('{');
+    mEmpty.append(true);
+}
+
+void JsonWriter::endObject()
+{
+    mBuffer.append('}');
+    mEmpty.resize(mEmpty.size() - 1);
+}
+
+void JsonWriter::beginArray()
+{
+    separate();
+    mBuffer.append('[');
+    mEmpty.append(true);
+}
+
+void JsonWriter::beginArray(const char *key)
+{
+    writeKey(key);
+    mBuffer.append('[');
+    mEmpty.append(true);
+}
+
+void JsonWriter::endArray()
+{
+    mBuffer.append(']');
+    mEmpty.resize(mEmpty.size() - 1);
+}
+
+void JsonWriter::insert(const char *key, bool value)
+{
+    writeKey(key);
+    mBuffer.append(value ? "true" : "false");
+}
+
+void JsonWriter::insert(const char *key, int value)
+{
+    writeKey(key);
+    writeNumber((qint64) value);
+}
+
+void JsonWriter::insert(const char *key, qint64 value)
+{
+    writeKey(key);
+    writeNumber(value);
+}
+
+void JsonWriter::insert(const char *key, double value)
+{
+    writeKey(key);
+    writeNumber(value);
+}
+
+void JsonWriter::insert(const char *key, const char *value)
+{
+    writeKey(key);
+    writeString(value, qstrlen(value));
+}
+
+void JsonWriter::insert(const char *key, const QString &value)
+{
+    writeKey(key);
+    QByteArray utf8 = value.toUtf8();
+    writeString(utf8.constData(), utf8.size());
+}
+
+void JsonWriter::insert(const char *key, const QStringList &value)
+{
+    beginArray(key);
+    Q_FOREACH(const QString &item, value)
+        append(item);
+    endArray();
+}
+
+void JsonWriter::insert(const char *key, const QJsonValue &value)
+{
+    writeKey(key);
+    writeValue(value);
+}
+
+void JsonWriter::append(bool value)
+{
+    separate();
+    mBuffer.append(value ? "true" : "false");
+}
+
+void JsonWriter::append(int value)
+{
+    separate();
+    writeNumber((qint64) value);
+}
+
+void JsonWriter::append(qint64 value)
+{
+    separate();
+    writeNumber(value);
+}
+
+void JsonWriter::append(double value)
+{
+    separate();
+    writeNumber(value);
+}
+
+void JsonWriter::append(const char *value)
+{
+    separate();
+    writeString(value, qstrlen(value));
+}
+
+void JsonWriter::append(const QString &value)
+{
+    separate();
+    QByteArray utf8 = value.toUtf8();
+    writeString(utf8.constData(), utf8.size());
+}
+
+void JsonWriter::append(const QJsonValue &value)
+{
+    separate();
+    writeValue(value);
+}
+
+const char* JsonWriter::constData() const
+{
+    return mBuffer.constData();
+}
+
+QByteArray JsonWriter::data() const
+{
+    return mBuffer;
+}
+
+int JsonWriter::size() const
+{
+    return mBuffer.size();
+}
+
+QByteArray JsonWriter::quote(const QString &value)
+{
+    JsonWriter writer(value.size() + 2);
+    writer.append(value);
+    return writer.data();
+}
+
+void JsonWriter::separate()
+{
+    if (mEmpty.isEmpty())
+        return;
+
+    bool &empty = mEmpty[mEmpty.size() - 1];
+    if (empty)
+        empty = false;
+    else
+        mBuffer.append(',');
+}
+
+void JsonWriter::writeKey(const char *key)
+{
+    separate();
+    writeString(key, qstrlen(key));
+    mBuffer.append(':');
+}
+
+void JsonWriter::writeNumber(qint64 value)
+{
+    char digits[24];
+    int pos = sizeof(digits);
+
+    quint64 magnitude = value < 0 ? 0 - (quint64) value : (quint64) value;
+    do {
+        digits[--pos] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    if (value < 0)
+        digits[--pos] = '-';
+
+    mBuffer.append(digits + pos, sizeof(digits) - pos);
+}
+
+void JsonWriter::writeNumber(double value)
+{
+    // JSON has no representation for these, QJsonDocument writes null as well
+    if (isnan(value) || isinf(value)) {
+        mBuffer.append("null");
+        return;
+    }
+
+    if (qAbs(value) < 1e15 && value == (qint64) value) {
+        writeNumber((qint64) value);
+        return;
+    }
+
+    mBuffer.append(QByteArray::number(value, 'g', 17));
+}
+
+void JsonWriter::writeString(const char *value, int length)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    mBuffer.append('"');
+
+    // Copy everything which doesn't need to be escaped in one go
+    int start = 0;
+    for (int n = 0; n < length; n++) {
+        unsigned char c = value[n];
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        mBuffer.append(value + start, n - start);
+        start = n + 1;
+
+        switch (c) {
+        case '"':
+            mBuffer.append("\\\"");
+            break;
+        case '\\':
+            mBuffer.append("\\\\");
+            break;
+        case '\b':
+            mBuffer.append("\\b");
+            break;
+        case '\f':
+            mBuffer.append("\\f");
+            break;
+        case '\n':
+            mBuffer.append("\\n");
+            break;
+        case '\r':
+            mBuffer.append("\\r");
+            break;
+        case '\t':
+            mBuffer.append("\\t");
+            break;
+        default:
+            mBuffer.append("\\u00");
+            mBuffer.append(hex[c >> 4]);
+            mBuffer.append(hex[c & 0xf]);
+            break;
+        }
+    }
+
+    mBuffer.append(value + start, length - start);
+    mBuffer.append('"');
+}
+
+void JsonWriter::writeValue(const QJsonValue &value)
+{
+    switch (value.type()) {
+    case QJsonValue::Bool:
+        mBuffer.append(value.toBool() ? "true" : "false");
+        break;
+    case QJsonValue::Double:
+        writeNumber(value.toDouble());
+        break;
+    case QJsonValue::String: {
+        QByteArray utf8 = value.toString().toUtf8();
+        writeString(utf8.constData(), utf8.size());
+        break;
+    }
+    case QJsonValue::Array: {
+        mBuffer.append('[');
+        mEmpty.append(true);
+        Q_FOREACH(const QJsonValue &item, value.toArray())
+            append(item);
+        endArray();
+        break;
+    }
+    case QJsonValue::Object: {
+        QJsonObject object = value.toObject();
+        mBuffer.append('{');
+        mEmpty.append(true);
+        for (QJsonObject::const_iterator it = object.constBegin(); it != object.constEnd(); ++it) {
+            separate();
+            QByteArray key = it.key().toUtf8();
+            writeString(key.constData(), key.size());
+            mBuffer.append(':');
+            writeValue(it.value());
+        }
+        endObject();
+        break;
+    }
+    default:
+        mBuffer.append("null");
+        break;
+    }
+}
+
+} // namespace luna
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <QByteArray>
+#include <QJsonValue>
+#include <QString>
+#include <QStringList>
+#include <QVarLengthArray>
+
+namespace luna
+{
+
+/*
+ * Writes compact JSON straight into a byte buffer without building a
+ * QJsonDocument first. All strings are escaped. The buffer keeps its capacity
+ * when the writer is cleared so one writer can be reused for many documents
+ * without allocating again.
+ *
+ * Values are added with insert() while inside an object and with append()
+ * while inside an array:
+ *
+ *     JsonWriter writer;
+ *     writer.beginObject();
+ *     writer.insert("returnValue", true);
+ *     writer.beginArray("apps");
+ *     writer.append(appId);
+ *     writer.endArray();
+ *     writer.endObject();
+ */
+class JsonWriter
+{
+public:
+    explicit JsonWriter(int reserve = 256);
+
+    void clear();
+
+    void beginObject();
+    void beginObject(const char *key);
+    void endObject();
+
+    void beginArray();
+    void beginArray(const char *key);
+    void endArray();
+
+    void insert(const char *key, bool value);
+    void insert(const char *key, int value);
+    void insert(const char *key, qint64 value);
+    void insert(const char *key, double value);
+    void insert(const char *key, const char *value);
+    void insert(const char *key, const QString &value);
+    void insert(const char *key, const QStringList &value);
+    void insert(const char *key, const QJsonValue &value);
+
+    void append(bool value);
+    void append(int value);
+    void append(qint64 value);
+    void append(double value);
+    void append(const char *value);
+    void append(const QString &value);
+    void append(const QJsonValue &value);
+
+    const char* constData() const;
+    QByteArray data() const;
+    int size() const;
+
+    static QByteArray quote(const QString &value);
+
+private:
+    QByteArray mBuffer;
+    // one entry per open object or array telling whether it's still empty
+    QVarLengthArray<bool, 16> mEmpty;
+
+    void separate();
+    void writeKey(const char *key);
+    void writeNumber(qint64 value);
+    void writeNumber(double value);
+    void writeString(const char *value, int length);
+    void writeValue(const QJsonValue &value);
+};
+
+} // namespace luna
+
+#endif // JSONWRITER_H
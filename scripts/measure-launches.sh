@@ -0,0 +1,72 @@
+#!/bin/sh
+#
+# Launches a number of cards one after another and reports how long the
+# launch phases took on average and how much memory the web app manager and
+# its web processes need per card afterwards.
+#
+# To compare an option run it once with the default options of
+# LunaWebAppManager and once with the option under test, e.g. for the shared
+# QML engine:
+#
+#   LunaWebAppManager --verbose
+#   measure-launches.sh <10 app ids>
+#   (close the cards, restart with --shared-qml-engine and run it again)
+#
+# The firstFrame phase is the time to the first pixel of a card. Compare a
+# run with --no-splash against one with the default options to measure what
+# the splash gains.
+#
+# None of the given applications may be running when the script is started.
+#
+# Usage: measure-launches.sh <app id>...
+
+SERVICE=palm://org.webosports.webappmanager
+
+# Seconds to wait after each launch so the card is fully loaded before the
+# next one is started
+LAUNCH_INTERVAL=${LAUNCH_INTERVAL:-3}
+
+PHASES="windowCreated containerLoaded webViewConfigured loadStarted loadSucceeded stageReady revealed firstFrame"
+
+if [ $# -eq 0 ] ; then
+    echo "Usage: $0 <app id>..."
+    exit 1
+fi
+
+# Proportional set size in kB of all processes with the given name
+pss_of() {
+    total=0
+    for pid in $(pidof "$1") ; do
+        pss=$(awk '/^Pss:/ { sum += $2 } END { print sum + 0 }' /proc/$pid/smaps 2>/dev/null)
+        total=$((total + ${pss:-0}))
+    done
+    echo $total
+}
+
+memory() {
+    echo $(($(pss_of LunaWebAppManager) + $(pss_of QtWebProcess)))
+}
+
+before=$(memory)
+
+for app in "$@" ; do
+    luna-send -n 1 palm://com.palm.applicationManager/launch "{\"id\":\"$app\"}" > /dev/null
+    sleep $LAUNCH_INTERVAL
+done
+
+after=$(memory)
+
+echo "Cards launched:      $#"
+echo "Memory before:       $before kB"
+echo "Memory after:        $after kB"
+echo "Memory per card:     $(((after - before) / $#)) kB"
+echo
+
+timings=$(luna-send -n 1 $SERVICE/getLaunchTimings '{}')
+
+echo "Average milliseconds from receiving the launch request:"
+for phase in $PHASES ; do
+    echo "$timings" | grep -o "\"$phase\":[0-9.]*" | cut -d: -f2 |
+        awk -v phase=$phase '{ sum += $1; n++ }
+                             END { if (n) printf "  %-18s %8.1f (%d apps)\n", phase, sum / n, n }'
+done
@@ -21,6 +21,7 @@
 #include <glib.h>
 
 #include "activity.h"
+#include "jsonreader.h"
 
 namespace luna
 {
@@ -112,16 +113,14 @@ bool Activity::activityCallback(LSHandle *handle, LSMessage *message, void *user
 
 void Activity::handleActivityResponse(LSMessage *message)
 {
-    QJsonDocument payload = QJsonDocument::fromJson(QByteArray(LSMessageGetPayload(message)));
-    if (!payload.isObject())
+    JsonReader response(LSMessageGetPayload(message));
+    if (!response.isValid())
         return;
 
-    QJsonObject response = payload.object();
-
-    if (!response.value("returnValue").toBool(false))
+    if (!response.boolean("returnValue"))
         return;
 
-    mId = response.value("activityId").toInt(-1);
+    mId = response.integer("activityId", -1);
 }
 
 int Activity::id() const
@@ -15,19 +15,19 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 
-#include <QJsonDocument>
 #include <QJsonObject>
-#include <QJsonArray>
 #include <QFile>
 #include <QDebug>
 
 #include "applicationdescription.h"
+#include "jsonreader.h"
 
 namespace luna
 {
 
 ApplicationDescription::ApplicationDescription() :
-    mHeadless(false)
+    mHeadless(false),
+    mLoadOnFirstShow(false)
 {
 }
 
@@ -44,7 +44,8 @@ ApplicationDescription::ApplicationDescription(const ApplicationDescription& oth
     mUrlsAllowed(other.urlsAllowed()),
     mUserAgent(other.userAgent()),
     mLoadingAnimationDisabled(other.loadingAnimationDisabled()),
-    mAllowCrossDomainAccess(other.allowCrossDomainAccess())
+    mAllowCrossDomainAccess(other.allowCrossDomainAccess()),
+    mLoadOnFirstShow(other.loadOnFirstShow())
 {
 }
 
@@ -55,40 +56,75 @@ ApplicationDescription::ApplicationDescription(const QString &data) :
     mApplicationBasePath(""),
     mUserAgent(""),
     mLoadingAnimationDisabled(false),
-    mAllowCrossDomainAccess(false)
+    mAllowCrossDomainAccess(false),
+    mLoadOnFirstShow(false)
 {
     initializeFromData(data);
 }
 
+ApplicationDescription::ApplicationDescription(const QJsonObject &data) :
+    mHeadless(false),
+    mFlickable(false),
+    mInternetConnectivityRequired(false),
+    mApplicationBasePath(""),
+    mUserAgent(""),
+    mLoadingAnimationDisabled(false),
+    mAllowCrossDomainAccess(false),
+    mLoadOnFirstShow(false)
+{
+    initializeFromObject(data);
+}
+
+ApplicationDescription::ApplicationDescription(const JsonReader &data) :
+    mHeadless(false),
+    mFlickable(false),
+    mInternetConnectivityRequired(false),
+    mApplicationBasePath(""),
+    mUserAgent(""),
+    mLoadingAnimationDisabled(false),
+    mAllowCrossDomainAccess(false),
+    mLoadOnFirstShow(false)
+{
+    initialize(data);
+}
+
 ApplicationDescription::~ApplicationDescription()
 {
 }
 
 void ApplicationDescription::initializeFromData(const QString &data)
 {
-    QJsonDocument document = QJsonDocument::fromJson(data.toUtf8());
+    JsonReader reader(data.toUtf8());
 
-    if (!document.isObject()) {
+    if (!reader.isValid()) {
         qWarning() << "Failed to parse application description";
         return;
     }
 
-    QJsonObject rootObject = document.object();
+    initialize(reader);
+}
+
+void ApplicationDescription::initializeFromObject(const QJsonObject &rootObject)
+{
+    initialize(JsonReader(rootObject));
+}
 
-    if (rootObject.contains("id") && rootObject.value("id").isString())
-        mId = rootObject.value("id").toString();
+void ApplicationDescription::initialize(const JsonReader &reader)
+{
+    if (reader.isString("id"))
+        mId = reader.string("id");
 
-    if (rootObject.contains("main") && rootObject.value("main").isString())
-        mEntryPoint = locateEntryPoint(rootObject.value("main").toString());
+    if (reader.isString("main"))
+        mEntryPoint = locateEntryPoint(reader.string("main"));
 
-    if (rootObject.contains("noWindow") && rootObject.value("noWindow").isBool())
-        mHeadless = rootObject.value("noWindow").toBool();
+    if (reader.isBool("noWindow"))
+        mHeadless = reader.boolean("noWindow");
 
-    if (rootObject.contains("title") && rootObject.value("title").isString())
-        mTitle = rootObject.value("title").toString();
+    if (reader.isString("title"))
+        mTitle = reader.string("title");
 
-    if (rootObject.contains("icon") && rootObject.value("icon").isString()) {
-        QString iconPath = rootObject.value("icon").toString();
+    if (reader.isString("icon")) {
+        QString iconPath = reader.string("icon");
 
         // we're only allow locally stored icons so we must prefix them with file:// to
         // store it in a QUrl object
@@ -100,36 +136,32 @@ void ApplicationDescription::initializeFromData(const QString &data)
         mIcon = iconPath;
     }
 
-    if (rootObject.contains("flickable") && rootObject.value("flickable").isBool())
-        mFlickable = rootObject.value("flickable").toBool();
+    if (reader.isBool("flickable"))
+        mFlickable = reader.boolean("flickable");
 
-    if (rootObject.contains("internetConnectivityRequired") && rootObject.value("internetConnectivityRequired").isBool())
-        mInternetConnectivityRequired = rootObject.value("internetConnectivityRequired").toBool();
+    if (reader.isBool("internetConnectivityRequired"))
+        mInternetConnectivityRequired = reader.boolean("internetConnectivityRequired");
 
     if (mIcon.isEmpty() || !mIcon.isLocalFile() || !QFile::exists(mIcon.toLocalFile()))
         mIcon = QUrl("qrc:///qml/images/default-app-icon.png");
 
-    if (rootObject.contains("urlsAllowed") && rootObject.value("urlsAllowed").isArray()) {
-        QJsonArray urlsAllowed = rootObject.value("urlsAllowed").toArray();
-        for (int n = 0; n < urlsAllowed.size(); n++) {
-            if (!urlsAllowed[n].isString())
-                continue;
+    if (reader.isArray("urlsAllowed"))
+        mUrlsAllowed.append(reader.stringList("urlsAllowed"));
 
-            mUrlsAllowed.append(urlsAllowed[n].toString());
-        }
-    }
+    if (reader.isString("plugin"))
+        mPluginName = reader.string("plugin");
 
-    if (rootObject.contains("plugin") && rootObject.value("plugin").isString())
-        mPluginName = rootObject.value("plugin").toString();
+    if (reader.isString("userAgent"))
+        mUserAgent = reader.string("userAgent");
 
-    if (rootObject.contains("userAgent") && rootObject.value("userAgent").isString())
-        mUserAgent = rootObject.value("userAgent").toString();
+    if (reader.isBool("loadingAnimationDisabled"))
+        mLoadingAnimationDisabled = reader.boolean("loadingAnimationDisabled");
 
-    if (rootObject.contains("loadingAnimationDisabled") && rootObject.value("loadingAnimationDisabled").isBool())
-        mLoadingAnimationDisabled = rootObject.value("loadingAnimationDisabled").toBool();
+    if (reader.isBool("allowCrossDomainAccess"))
+        mAllowCrossDomainAccess = reader.boolean("allowCrossDomainAccess");
 
-    if (rootObject.contains("allowCrossDomainAccess") && rootObject.value("allowCrossDomainAccess").isBool())
-        mAllowCrossDomainAccess = rootObject.value("allowCrossDomainAccess").toBool();
+    if (reader.isBool("loadOnFirstShow"))
+        mLoadOnFirstShow = reader.boolean("loadOnFirstShow");
 }
 
 QUrl ApplicationDescription::locateEntryPoint(const QString &entryPoint)
@@ -222,4 +254,9 @@ bool ApplicationDescription::allowCrossDomainAccess() const
     return mAllowCrossDomainAccess;
 }
 
+bool ApplicationDescription::loadOnFirstShow() const
+{
+    return mLoadOnFirstShow;
+}
+
 }
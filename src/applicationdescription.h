@@ -22,10 +22,13 @@
 #include <QString>
 #include <QUrl>
 #include <QStringList>
+#include <QJsonObject>
 
 namespace luna
 {
 
+class JsonReader;
+
 class ApplicationDescription : public QObject
 {
     Q_OBJECT
@@ -37,11 +40,14 @@ class ApplicationDescription : public QObject
     Q_PROPERTY(bool flickable READ flickable CONSTANT)
     Q_PROPERTY(bool internetConnectivityRequired READ internetConnectivityRequired CONSTANT)
     Q_PROPERTY(bool loadingAnimationDisabled READ loadingAnimationDisabled CONSTANT)
+    Q_PROPERTY(bool loadOnFirstShow READ loadOnFirstShow CONSTANT)
 
 public:
     ApplicationDescription();
     ApplicationDescription(const ApplicationDescription& other);
     ApplicationDescription(const QString &data);
+    ApplicationDescription(const QJsonObject &data);
+    ApplicationDescription(const JsonReader &data);
     virtual ~ApplicationDescription();
 
     QString id() const;
@@ -55,6 +61,7 @@ public:
     QString userAgent() const;
     bool loadingAnimationDisabled() const;
     bool allowCrossDomainAccess() const;
+    bool loadOnFirstShow() const;
 
     QString pluginName() const;
     QString basePath() const;
@@ -75,8 +82,11 @@ private:
     QString mUserAgent;
     bool mLoadingAnimationDisabled;
     bool mAllowCrossDomainAccess;
+    bool mLoadOnFirstShow;
 
     void initializeFromData(const QString &data);
+    void initializeFromObject(const QJsonObject &rootObject);
+    void initialize(const JsonReader &reader);
     QUrl locateEntryPoint(const QString &entryPoint);
 };
 
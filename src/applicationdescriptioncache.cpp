@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDebug>
+
+#include "applicationdescriptioncache.h"
+
+namespace luna
+{
+
+ApplicationDescriptionCache::ApplicationDescriptionCache()
+{
+}
+
+ApplicationDescriptionPtr ApplicationDescriptionCache::lookup(const QString &appId, quint64 hash) const
+{
+    QHash<QString, Entry>::const_iterator iter = mEntries.constFind(appId);
+    if (iter == mEntries.constEnd() || iter.value().hash != hash)
+        return ApplicationDescriptionPtr();
+
+    return iter.value().description;
+}
+
+ApplicationDescriptionPtr ApplicationDescriptionCache::lookupByAppId(const QString &appId) const
+{
+    return mEntries.value(appId).description;
+}
+
+void ApplicationDescriptionCache::insert(quint64 hash, const ApplicationDescriptionPtr &description)
+{
+    QString appId = description->id();
+    if (appId.isEmpty())
+        return;
+
+    // replaces the entry for a previous version of the description
+    Entry entry;
+    entry.hash = hash;
+    entry.description = description;
+
+    mEntries.insert(appId, entry);
+
+    qDebug() << __PRETTY_FUNCTION__ << "Cached description for app" << appId;
+}
+
+void ApplicationDescriptionCache::remove(const QString &appId)
+{
+    mEntries.remove(appId);
+}
+
+void ApplicationDescriptionCache::clear()
+{
+    mEntries.clear();
+}
+
+int ApplicationDescriptionCache::count() const
+{
+    return mEntries.count();
+}
+
+} // namespace luna
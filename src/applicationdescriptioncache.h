@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef APPLICATIONDESCRIPTIONCACHE_H
+#define APPLICATIONDESCRIPTIONCACHE_H
+
+#include <QHash>
+#include <QString>
+#include <QSharedPointer>
+
+#include "applicationdescription.h"
+
+namespace luna
+{
+
+typedef QSharedPointer<const ApplicationDescription> ApplicationDescriptionPtr;
+
+/*
+ * Caches parsed application descriptions of valid applications. Entries are
+ * found by the application id together with the hash of the description
+ * object, see JsonReader::hash(), and every application id only keeps the
+ * entry for the description it was launched with most recently, so a changed
+ * description replaces the old one.
+ *
+ * Only descriptions of valid applications are added so a hit doesn't need to
+ * check the files of the application again, while an application which
+ * wasn't installed yet when it was asked for is checked again next time.
+ */
+class ApplicationDescriptionCache
+{
+public:
+    ApplicationDescriptionCache();
+
+    ApplicationDescriptionPtr lookup(const QString &appId, quint64 hash) const;
+    ApplicationDescriptionPtr lookupByAppId(const QString &appId) const;
+    void insert(quint64 hash, const ApplicationDescriptionPtr &description);
+    void remove(const QString &appId);
+    void clear();
+
+    int count() const;
+
+private:
+    struct Entry
+    {
+        quint64 hash;
+        ApplicationDescriptionPtr description;
+    };
+
+    QHash<QString, Entry> mEntries;
+};
+
+} // namespace luna
+
+#endif // APPLICATIONDESCRIPTIONCACHE_H
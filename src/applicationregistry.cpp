@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <algorithm>
+
+#include "applicationregistry.h"
+#include "webapplication.h"
+
+namespace luna
+{
+
+ApplicationRegistry::ApplicationRegistry()
+{
+}
+
+void ApplicationRegistry::add(WebApplication *app)
+{
+    mByProcessId.insert(app->processId(), app);
+    mByAppId.insert(app->id(), app);
+}
+
+void ApplicationRegistry::remove(WebApplication *app)
+{
+    if (mByProcessId.value(app->processId()) == app)
+        mByProcessId.remove(app->processId());
+
+    mByAppId.remove(app->id(), app);
+}
+
+void ApplicationRegistry::updateProcessId(WebApplication *app, int64_t oldProcessId)
+{
+    if (mByProcessId.value(oldProcessId) == app)
+        mByProcessId.remove(oldProcessId);
+
+    mByProcessId.insert(app->processId(), app);
+}
+
+WebApplication* ApplicationRegistry::findByAppId(const QString &appId) const
+{
+    // QMultiHash returns the most recently inserted value first
+    return mByAppId.value(appId, 0);
+}
+
+WebApplication* ApplicationRegistry::findByProcessId(int64_t processId) const
+{
+    return mByProcessId.value(processId, 0);
+}
+
+QList<WebApplication*> ApplicationRegistry::findAllByAppId(const QString &appId) const
+{
+    return mByAppId.values(appId);
+}
+
+bool ApplicationRegistry::contains(const QString &appId) const
+{
+    return mByAppId.contains(appId);
+}
+
+bool ApplicationRegistry::contains(WebApplication *app) const
+{
+    return mByAppId.contains(app->id(), app);
+}
+
+static bool startedBefore(WebApplication *app, WebApplication *other)
+{
+    return app->processId() < other->processId();
+}
+
+QList<WebApplication*> ApplicationRegistry::applications() const
+{
+    // Keep the order stable for everybody listing the applications instead
+    // of handing out the order of the hash
+    QList<WebApplication*> apps = mByAppId.values();
+    std::sort(apps.begin(), apps.end(), startedBefore);
+    return apps;
+}
+
+int ApplicationRegistry::count() const
+{
+    return mByAppId.count();
+}
+
+} // namespace luna
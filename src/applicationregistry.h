@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef APPLICATIONREGISTRY_H
+#define APPLICATIONREGISTRY_H
+
+#include <QHash>
+#include <QList>
+#include <QMultiHash>
+#include <QString>
+
+#include <stdint.h>
+
+namespace luna
+{
+
+class WebApplication;
+
+/*
+ * Keeps track of all running applications and indexes them by their process
+ * id and by their application id so finding one doesn't depend on how many
+ * are running. An application id can have several instances running; lookups
+ * by application id return the most recently added one.
+ */
+class ApplicationRegistry
+{
+public:
+    ApplicationRegistry();
+
+    void add(WebApplication *app);
+    void remove(WebApplication *app);
+    void updateProcessId(WebApplication *app, int64_t oldProcessId);
+
+    WebApplication* findByAppId(const QString &appId) const;
+    WebApplication* findByProcessId(int64_t processId) const;
+    QList<WebApplication*> findAllByAppId(const QString &appId) const;
+
+    bool contains(const QString &appId) const;
+    bool contains(WebApplication *app) const;
+
+    QList<WebApplication*> applications() const;
+    int count() const;
+
+private:
+    QHash<int64_t, WebApplication*> mByProcessId;
+    QMultiHash<QString, WebApplication*> mByAppId;
+};
+
+} // namespace luna
+
+#endif // APPLICATIONREGISTRY_H
@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * Compares the ways the service can check a request against the schema of its
+ * method and read its parameters, for the payloads it gets most often:
+ *
+ *  - jsax+JsonReader: the payload is checked by pbnjson without building
+ *    anything and parsed again by JsonReader, with simdjson when it's built
+ *    with it and with QJsonDocument otherwise
+ *  - jsax+QJsonDoc: the same with QJsonDocument always
+ *  - jdom: the payload is parsed once by pbnjson which checks it while it
+ *    builds its DOM, and JsonReader reads from that DOM
+ *
+ * Every method reads the parameters the handler of the method reads, so
+ * converting strings when they're asked for counts as well.
+ */
+
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <functional>
+
+#include "jsonreader.h"
+#include "lunaserviceutils.h"
+
+/* Numbers of applications launched with one launchApps request */
+static const int appCounts[] = { 1, 8, 32, -1 };
+
+/* Number of applications a registerForAppEvents subscriber filters on */
+#define BENCHMARK_APP_IDS       10
+
+/* The schemas of the methods measured, the same the service compiles */
+static const struct {
+    const char *method;
+    const char *schema;
+} methodSchemas[] = {
+    { "launchApp",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"appDesc\":{\"type\":\"object\"},"
+      "\"processId\":{\"type\":[\"number\",\"string\"]},"
+      "\"respondOn\":{\"enum\":[\"created\",\"loaded\",\"ready\"]},"
+      "\"timeout\":{\"type\":\"integer\"}},"
+      "\"required\":[\"appDesc\",\"processId\"]}" },
+    { "launchApps",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"apps\":{\"type\":\"array\",\"items\":{\"type\":\"object\"}}},"
+      "\"required\":[\"apps\"]}" },
+    { "isAppRunning",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"appId\":{\"type\":\"string\"}},"
+      "\"required\":[\"appId\"]}" },
+    { "registerForAppEvents",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"subscribe\":{\"type\":\"boolean\"},"
+      "\"appIds\":{\"type\":\"array\",\"items\":{\"type\":\"string\"}},"
+      "\"events\":{\"type\":\"array\",\"items\":{\"enum\":[\"start\",\"close\",\"fail\"]}},"
+      "\"since\":{\"type\":\"number\"}}}" },
+    { NULL, NULL }
+};
+
+static gint option_iterations = 20000;
+
+static GOptionEntry options[] = {
+    { "iterations", 'i', 0, G_OPTION_ARG_INT, &option_iterations,
+        "Number of payloads read per payload shape and method" },
+    { NULL },
+};
+
+typedef std::function<quint64 (const luna::JsonReader &root)> ReadFunction;
+
+static QByteArray appDescription(int n)
+{
+    return QString("{\"id\":\"org.webosports.app.benchmark%1\",\"title\":\"Benchmark %1\","
+                   "\"vendor\":\"WebOS Ports\",\"version\":\"1.0.%1\",\"main\":\"index.html\","
+                   "\"icon\":\"icon.png\",\"folderPath\":\"/usr/palm/applications/"
+                   "org.webosports.app.benchmark%1\",\"uiRevision\":2,\"noWindow\":false,"
+                   "\"trustScope\":\"default\",\"plugin\":false,\"visible\":true,"
+                   "\"requiredMemory\":32,\"keywords\":[\"benchmark\",\"app%1\"]}")
+        .arg(n).toUtf8();
+}
+
+static QByteArray launchAppPayload()
+{
+    return "{\"appDesc\":" + appDescription(0) +
+           ",\"params\":{\"target\":\"http://www.webos-ports.org\"}"
+           ",\"processId\":1001,\"respondOn\":\"loaded\",\"timeout\":10000}";
+}
+
+static QByteArray launchAppsPayload(int count)
+{
+    QByteArray payload = "{\"apps\":[";
+    for (int n = 0; n < count; n++) {
+        if (n > 0)
+            payload += ",";
+        payload += "{\"appDesc\":" + appDescription(n) + ",\"processId\":" +
+                   QByteArray::number(1001 + n) + "}";
+    }
+    payload += "]}";
+
+    return payload;
+}
+
+static QByteArray registerForAppEventsPayload()
+{
+    QStringList appIds;
+    for (int n = 0; n < BENCHMARK_APP_IDS; n++)
+        appIds.append(QString("\"org.webosports.app.benchmark%1\"").arg(n));
+
+    return QString("{\"subscribe\":true,\"appIds\":[%1],\"events\":[\"start\",\"close\"],\"since\":1000}")
+        .arg(appIds.join(",")).toUtf8();
+}
+
+/* The parameters each handler reads folded into something to compare */
+
+static quint64 readLaunchApp(const luna::JsonReader &root)
+{
+    luna::JsonReader appDesc = root.object("appDesc");
+
+    return appDesc.hash() + appDesc.string("id").size() + root.integer("processId") +
+           root.string("respondOn").size() + root.integer("timeout");
+}
+
+static quint64 readLaunchApps(const luna::JsonReader &root)
+{
+    quint64 result = 0;
+    Q_FOREACH(const luna::JsonReader &app, root.objects("apps"))
+        result += readLaunchApp(app);
+
+    return result;
+}
+
+static quint64 readIsAppRunning(const luna::JsonReader &root)
+{
+    return root.string("appId").size();
+}
+
+static quint64 readRegisterForAppEvents(const luna::JsonReader &root)
+{
+    return root.stringList("appIds").join(",").size() + root.stringList("events").count() +
+           (quint64) root.number("since") + root.boolean("subscribe");
+}
+
+static bool validate(const char *method, const QByteArray &payload)
+{
+    JSchemaInfo schema_info;
+
+    jschema_info_init(&schema_info, luna_service_schema_lookup(method), NULL, NULL);
+
+    // Without any callbacks the parser only checks the payload against the
+    // schema and doesn't build anything
+    return jsax_parse(NULL, j_cstr_to_buffer(payload.constData()), &schema_info);
+}
+
+static quint64 readWithJsonReader(const char *method, const QByteArray &payload, const ReadFunction &read)
+{
+    if (!validate(method, payload))
+        return 0;
+
+    return read(luna::JsonReader(payload));
+}
+
+static quint64 readWithJsonDocument(const char *method, const QByteArray &payload, const ReadFunction &read)
+{
+    if (!validate(method, payload))
+        return 0;
+
+    QJsonDocument document = QJsonDocument::fromJson(payload);
+    if (!document.isObject())
+        return 0;
+
+    return read(luna::JsonReader(document.object()));
+}
+
+static quint64 readWithDom(const char *method, const QByteArray &payload, const ReadFunction &read)
+{
+    jvalue_ref parsed = luna_service_message_parse_and_validate_method(method, payload.constData());
+    if (!parsed)
+        return 0;
+
+    luna::JsonReader root(parsed);
+    if (!root.isValid())
+        return 0;
+
+    return read(root);
+}
+
+static void measure(const char *shape, int count, const char *method, const QByteArray &payload,
+                    const ReadFunction &read)
+{
+    static const struct {
+        const char *name;
+        quint64 (*function)(const char *method, const QByteArray &payload, const ReadFunction &read);
+    } readers[] = {
+        { "jsax+JsonReader", readWithJsonReader },
+        { "jsax+QJsonDoc", readWithJsonDocument },
+        { "jdom", readWithDom },
+        { NULL, NULL }
+    };
+
+    // Every reader has to read the same parameters or it's not worth comparing
+    quint64 expected = readWithJsonDocument(method, payload, read);
+    if (!expected)
+        printf("WARNING: %s payload isn't valid\n", shape);
+
+    for (int r = 0; readers[r].name; r++) {
+        if (readers[r].function(method, payload, read) != expected)
+            printf("WARNING: %s read other parameters than %s\n", readers[r].name, readers[1].name);
+
+        QElapsedTimer timer;
+        timer.start();
+
+        quint64 result = 0;
+        for (int n = 0; n < option_iterations; n++)
+            result += readers[r].function(method, payload, read);
+
+        qint64 elapsed = timer.nsecsElapsed();
+
+        printf("%-20s %6d %8d  %-16s %12.0f %10.0f\n", shape, count, payload.size(), readers[r].name,
+               option_iterations * 1000000000.0 / qMax(elapsed, (qint64) 1),
+               (double) elapsed / option_iterations);
+
+        if (result != expected * option_iterations)
+            printf("WARNING: %s read other parameters while measuring\n", readers[r].name);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    GError *error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(context, options, NULL);
+
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error ? error->message : "An unknown error occurred");
+        if (error)
+            g_error_free(error);
+        exit(1);
+    }
+
+    g_option_context_free(context);
+
+    if (option_iterations <= 0)
+        option_iterations = 1;
+
+    for (int n = 0; methodSchemas[n].method; n++) {
+        if (!luna_service_schema_register(methodSchemas[n].method, methodSchemas[n].schema)) {
+            g_printerr("Failed to compile schema of %s\n", methodSchemas[n].method);
+            exit(1);
+        }
+    }
+
+#ifdef HAVE_SIMDJSON
+    printf("JsonReader parses text with simdjson\n");
+#else
+    printf("JsonReader parses text with QJsonDocument\n");
+#endif
+
+    printf("%-20s %6s %8s  %-16s %12s %10s\n", "payload", "items", "bytes", "method", "payloads/s", "ns");
+
+    measure("isAppRunning", 1, "isAppRunning", "{\"appId\":\"org.webosports.app.benchmark0\"}",
+            readIsAppRunning);
+    measure("launchApp", 1, "launchApp", launchAppPayload(), readLaunchApp);
+    measure("registerForAppEvents", BENCHMARK_APP_IDS, "registerForAppEvents",
+            registerForAppEventsPayload(), readRegisterForAppEvents);
+
+    for (int c = 0; appCounts[c] > 0; c++)
+        measure("launchApps", appCounts[c], "launchApps", launchAppsPayload(appCounts[c]), readLaunchApps);
+
+    luna_service_schema_release_all();
+
+    return 0;
+}
@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * Measures the service methods of the web app manager the way a client on the
+ * bus sees them: every request is validated and decoded on the service thread
+ * and everything which isn't answered there goes through the main thread and
+ * back. There is neither a bus nor a compositor involved; the requests are
+ * made with WebAppManagerService::call() and the applications are stubs
+ * without an activity or a window.
+ *
+ * Requests are made one at a time so requests per second is the inverse of
+ * the average latency. Every method is measured with a growing number of
+ * running applications.
+ */
+
+#include <QAtomicInt>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QVector>
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <functional>
+
+#include "webappmanager.h"
+#include "webappmanagerservice.h"
+#include "webapplication.h"
+#include "windowpool.h"
+#include "sparewebprocess.h"
+#include "prelauncher.h"
+#include "servicerequest.h"
+#include "launchtimeline.h"
+
+/* Numbers of running applications every method is measured with */
+static const int appCounts[] = { 0, 10, 50, 100, 250, 500, 1000, -1 };
+
+/* Process ids of the applications launched to measure launchApp and killApp,
+ * well apart from the ones of the applications kept running */
+#define BENCHMARK_EXTRA_PROCESS_ID      1000000
+
+static gboolean option_verbose = FALSE;
+static gint option_iterations = 1000;
+static gint option_max_apps = 500;
+
+static GOptionEntry options[] = {
+    { "verbose", 0, 0, G_OPTION_ARG_NONE, &option_verbose, "Show the debug output of the manager" },
+    { "iterations", 'i', 0, G_OPTION_ARG_INT, &option_iterations,
+        "Number of requests made per method and number of running applications" },
+    { "max-apps", 0, 0, G_OPTION_ARG_INT, &option_max_apps,
+        "Largest number of running applications to measure with" },
+    { NULL },
+};
+
+namespace luna
+{
+
+/*
+ * Application without an activity or a window so a launch only costs what
+ * the manager and the service do for it.
+ */
+class StubApplication : public WebApplication
+{
+public:
+    StubApplication(WebAppManager *launcher, const ApplicationDescription &desc,
+                    const QJsonValue &parameters, int64_t processId,
+                    const LaunchTimeline &timeline, Prelaunch prelaunch) :
+        WebApplication(launcher, desc, parameters, processId, timeline, prelaunch)
+    {
+    }
+
+    void relaunch(const QString &parameters)
+    {
+        Q_UNUSED(parameters);
+    }
+
+    void clearMemoryCaches()
+    {
+    }
+};
+
+class BenchmarkWebAppManager : public WebAppManager
+{
+public:
+    BenchmarkWebAppManager(int &argc, char **argv) :
+        WebAppManager(argc, argv, false)
+    {
+    }
+
+protected:
+    WebApplication* createApplication(const QUrl &url, const QString &windowType,
+                                      const ApplicationDescription &desc,
+                                      const QJsonValue &parameters, int64_t processId,
+                                      const LaunchTimeline &timeline,
+                                      WebApplication::Prelaunch prelaunch)
+    {
+        Q_UNUSED(url);
+        Q_UNUSED(windowType);
+
+        return new StubApplication(this, desc, parameters, processId, timeline, prelaunch);
+    }
+};
+
+} // namespace luna
+
+static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    Q_UNUSED(context);
+
+    if (type == QtDebugMsg && !option_verbose)
+        return;
+
+    fprintf(stderr, "%s\n", msg.toUtf8().constData());
+}
+
+static qint64 callMethod(luna::WebAppManagerService *service, const QString &method,
+                         const QByteArray &payload, QByteArray &response)
+{
+    QAtomicInt done(0);
+
+    qint64 startedAt = luna::LaunchTimeline::now();
+
+    // The response is sent from the service thread which wakes us up so the
+    // loop below notices it
+    service->call(method, new luna::LocalServiceRequest(payload,
+            [&done, &response] (const QByteArray &result) {
+        response = result;
+        done.storeRelease(1);
+        g_main_context_wakeup(g_main_context_default());
+    }));
+
+    // Requests forwarded to the main thread are handled by this loop
+    while (!done.loadAcquire())
+        g_main_context_iteration(g_main_context_default(), TRUE);
+
+    qint64 latency = luna::LaunchTimeline::now() - startedAt;
+
+    if (luna::ServiceRequest::isFailure(response.constData()))
+        qWarning("%s failed: %s", method.toUtf8().constData(), response.constData());
+
+    return latency;
+}
+
+static QByteArray appDescription(const QString &appId, const QString &entryPoint)
+{
+    return QString("{\"id\":\"%1\",\"title\":\"Benchmark\",\"main\":\"%2\",\"noWindow\":false}")
+        .arg(appId).arg(entryPoint).toUtf8();
+}
+
+static QString runningAppId(int n)
+{
+    return QString("org.webosports.benchmark.app%1").arg(n);
+}
+
+static void launchRunningApps(luna::WebAppManagerService *service, const QString &entryPoint,
+                              int from, int to)
+{
+    QByteArray response;
+
+    for (int n = from; n < to; n++) {
+        QByteArray payload = "{\"appDesc\":" + appDescription(runningAppId(n), entryPoint) +
+                             ",\"processId\":" + QByteArray::number(n + 1) + "}";
+        callMethod(service, "launchApp", payload, response);
+    }
+}
+
+static void report(int apps, const char *method, QVector<qint64> latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+
+    qint64 total = 0;
+    Q_FOREACH(qint64 latency, latencies)
+        total += latency;
+
+    int count = latencies.count();
+    double rate = total > 0 ? count * 1000000.0 / total : 0;
+
+    printf("%6d  %-18s %10.0f %10lld %10lld\n", apps, method, rate,
+           (long long) latencies[count / 2],
+           (long long) latencies[qMin(count - 1, count * 99 / 100)]);
+}
+
+static void measure(luna::WebAppManagerService *service, int apps, const char *method,
+                    const std::function<QByteArray (int n)> &payload)
+{
+    QVector<qint64> latencies;
+    latencies.reserve(option_iterations);
+
+    QByteArray response;
+    for (int n = 0; n < option_iterations; n++)
+        latencies.append(callMethod(service, method, payload(n), response));
+
+    report(apps, method, latencies);
+}
+
+int main(int argc, char **argv)
+{
+    GError *error = NULL;
+    GOptionContext *context;
+
+    qInstallMessageHandler(messageHandler);
+
+    context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(context, options, NULL);
+
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error ? error->message : "An unknown error occurred");
+        if (error)
+            g_error_free(error);
+        exit(1);
+    }
+
+    g_option_context_free(context);
+
+    if (option_iterations <= 0)
+        option_iterations = 1;
+
+    // Nothing is ever shown so no compositor is needed and whatever the
+    // prelauncher learns doesn't end up with the real data
+    QTemporaryDir dataDir;
+    setenv("QT_QPA_PLATFORM", "minimal", 1);
+    setenv("XDG_DATA_HOME", QDir(dataDir.path()).filePath("data").toUtf8().constData(), 1);
+
+    // Descriptions are only valid when their entry point exists
+    QString entryPoint = QDir(dataDir.path()).filePath("index.html");
+    QFile entryPointFile(entryPoint);
+    entryPointFile.open(QIODevice::WriteOnly);
+    entryPointFile.close();
+
+    luna::BenchmarkWebAppManager webAppManager(argc, argv);
+
+    webAppManager.windowPool()->setSize(0);
+    webAppManager.spareWebProcess()->setEnabled(false);
+    webAppManager.prelauncher()->setMaxApplications(0);
+
+    luna::WebAppManagerService *service = webAppManager.service();
+
+    printf("%6s  %-18s %10s %10s %10s\n", "apps", "method", "req/s", "p50 us", "p99 us");
+
+    int running = 0;
+    for (int c = 0; appCounts[c] >= 0 && appCounts[c] <= option_max_apps; c++) {
+        int apps = appCounts[c];
+
+        launchRunningApps(service, entryPoint, running, apps);
+        running = apps;
+
+        // Spread the requests over all running applications
+        std::function<QString (int n)> appId = [apps] (int n) {
+            return apps > 0 ? runningAppId(n % apps) : QString("org.webosports.benchmark.missing");
+        };
+        std::function<int (int n)> processId = [apps] (int n) {
+            return apps > 0 ? n % apps + 1 : 0;
+        };
+
+        measure(service, apps, "isAppRunning", [&] (int n) -> QByteArray {
+            return "{\"appId\":\"" + appId(n).toUtf8() + "\"}";
+        });
+
+        measure(service, apps, "listRunningApps", [] (int n) -> QByteArray {
+            Q_UNUSED(n);
+            return QByteArray("{}");
+        });
+
+        measure(service, apps, "relaunch", [&] (int n) -> QByteArray {
+            return "{\"appId\":\"" + appId(n).toUtf8() + "\",\"params\":{\"benchmark\":true}}";
+        });
+
+        measure(service, apps, "clearMemoryCaches", [&] (int n) -> QByteArray {
+            return "{\"appId\":\"" + appId(n).toUtf8() + "\",\"processId\":" +
+                   QByteArray::number(processId(n)) + "}";
+        });
+
+        // Every launch is followed by killing the application again so the
+        // number of running applications stays the same
+        QVector<qint64> launchLatencies;
+        QVector<qint64> killLatencies;
+        QByteArray launchDesc = appDescription("org.webosports.benchmark.extra", entryPoint);
+        QByteArray response;
+
+        for (int n = 0; n < option_iterations; n++) {
+            QByteArray extraProcessId = QByteArray::number(BENCHMARK_EXTRA_PROCESS_ID + n);
+
+            launchLatencies.append(callMethod(service, "launchApp",
+                "{\"appDesc\":" + launchDesc + ",\"processId\":" + extraProcessId + "}", response));
+            killLatencies.append(callMethod(service, "killApp",
+                "{\"processId\":" + extraProcessId + "}", response));
+        }
+
+        report(apps, "launchApp", launchLatencies);
+        report(apps, "killApp", killLatencies);
+    }
+
+    return 0;
+}
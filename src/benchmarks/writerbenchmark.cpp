@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * Compares serializing the payloads the service sends most often with a
+ * reused JsonWriter against the ways they were put together before: building
+ * a QJsonObject and calling QJsonDocument::toJson, and filling in a template
+ * with QString::arg. The payloads are the application events posted to
+ * registerForAppEvents subscribers and the listRunningApps response.
+ */
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <functional>
+
+#include "jsonwriter.h"
+
+/* Numbers of events posted with one payload and of running applications
+ * listed in one response */
+static const int eventCounts[] = { 1, 8, 64, -1 };
+static const int appCounts[] = { 10, 100, 1000, -1 };
+
+static gint option_iterations = 20000;
+
+static GOptionEntry options[] = {
+    { "iterations", 'i', 0, G_OPTION_ARG_INT, &option_iterations,
+        "Number of payloads serialized per payload shape and method" },
+    { NULL },
+};
+
+struct Entry
+{
+    quint64 sequence;
+    QString event;
+    QString appId;
+    qint64 processId;
+};
+
+static QList<Entry> createEntries(int count)
+{
+    QList<Entry> entries;
+
+    for (int n = 0; n < count; n++) {
+        Entry entry;
+        entry.sequence = 1000 + n;
+        entry.event = n % 2 ? "closed" : "started";
+        entry.appId = QString("org.webosports.app.benchmark%1").arg(n);
+        entry.processId = 1001 + n;
+        entries.append(entry);
+    }
+
+    return entries;
+}
+
+static QByteArray eventsWithJsonDocument(const QList<Entry> &events)
+{
+    QJsonArray array;
+    Q_FOREACH(const Entry &event, events) {
+        QJsonObject eventObj;
+        eventObj.insert("sequence", (qint64) event.sequence);
+        eventObj.insert("event", event.event);
+        eventObj.insert("appId", event.appId);
+        eventObj.insert("processId", event.processId);
+        array.append(eventObj);
+    }
+
+    QJsonObject payload;
+    payload.insert("returnValue", true);
+    payload.insert("sequence", (qint64) events.last().sequence);
+    payload.insert("events", array);
+
+    return QJsonDocument(payload).toJson(QJsonDocument::Compact);
+}
+
+static QByteArray eventsWithArg(const QList<Entry> &events)
+{
+    // Like the hand written responses this doesn't escape anything
+    QStringList items;
+    Q_FOREACH(const Entry &event, events) {
+        items.append(QString("{\"sequence\":%1,\"event\":\"%2\",\"appId\":\"%3\",\"processId\":%4}")
+                     .arg(event.sequence).arg(event.event).arg(event.appId).arg(event.processId));
+    }
+
+    return QString("{\"returnValue\":true,\"sequence\":%1,\"events\":[%2]}")
+        .arg(events.last().sequence).arg(items.join(",")).toUtf8();
+}
+
+static QByteArray eventsWithWriter(luna::JsonWriter &writer, const QList<Entry> &events)
+{
+    writer.clear();
+    writer.beginObject();
+    writer.insert("returnValue", true);
+    writer.insert("sequence", (qint64) events.last().sequence);
+
+    writer.beginArray("events");
+    Q_FOREACH(const Entry &event, events) {
+        writer.beginObject();
+        writer.insert("sequence", (qint64) event.sequence);
+        writer.insert("event", event.event);
+        writer.insert("appId", event.appId);
+        writer.insert("processId", event.processId);
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.endObject();
+
+    // The service hands constData() to the bus; the copy here is shared and
+    // doesn't allocate
+    return QByteArray::fromRawData(writer.constData(), writer.size());
+}
+
+static QByteArray appsWithJsonDocument(const QList<Entry> &apps)
+{
+    QJsonArray array;
+    Q_FOREACH(const Entry &app, apps) {
+        QJsonObject appObj;
+        appObj.insert("appId", app.appId);
+        appObj.insert("processId", app.processId);
+        array.append(appObj);
+    }
+
+    QJsonObject response;
+    response.insert("returnValue", true);
+    response.insert("sequence", (qint64) apps.count());
+    response.insert("apps", array);
+
+    return QJsonDocument(response).toJson(QJsonDocument::Compact);
+}
+
+static QByteArray appsWithArg(const QList<Entry> &apps)
+{
+    QStringList items;
+    Q_FOREACH(const Entry &app, apps)
+        items.append(QString("{\"appId\":\"%1\",\"processId\":%2}").arg(app.appId).arg(app.processId));
+
+    return QString("{\"returnValue\":true,\"sequence\":%1,\"apps\":[%2]}")
+        .arg(apps.count()).arg(items.join(",")).toUtf8();
+}
+
+static QByteArray appsWithWriter(luna::JsonWriter &writer, const QList<Entry> &apps)
+{
+    writer.clear();
+    writer.beginObject();
+    writer.insert("returnValue", true);
+    writer.insert("sequence", (qint64) apps.count());
+
+    writer.beginArray("apps");
+    Q_FOREACH(const Entry &app, apps) {
+        writer.beginObject();
+        writer.insert("appId", app.appId);
+        writer.insert("processId", app.processId);
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.endObject();
+
+    return QByteArray::fromRawData(writer.constData(), writer.size());
+}
+
+static void measure(const char *payload, int count, const char *method,
+                    const std::function<QByteArray ()> &serialize)
+{
+    // One round before measuring so buffers which are reused already grew
+    int size = serialize().size();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 bytes = 0;
+    for (int n = 0; n < option_iterations; n++)
+        bytes += serialize().size();
+
+    qint64 elapsed = timer.nsecsElapsed();
+
+    printf("%-16s %6d  %-14s %12.0f %10.0f %8d\n", payload, count, method,
+           option_iterations * 1000000000.0 / qMax(elapsed, (qint64) 1),
+           (double) elapsed / option_iterations, (int) (bytes / option_iterations));
+
+    if (size * (qint64) option_iterations != bytes)
+        printf("WARNING: %s produced payloads of different sizes\n", method);
+}
+
+int main(int argc, char **argv)
+{
+    GError *error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(context, options, NULL);
+
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error ? error->message : "An unknown error occurred");
+        if (error)
+            g_error_free(error);
+        exit(1);
+    }
+
+    g_option_context_free(context);
+
+    if (option_iterations <= 0)
+        option_iterations = 1;
+
+    luna::JsonWriter writer;
+
+    printf("%-16s %6s  %-14s %12s %10s %8s\n", "payload", "items", "method", "payloads/s", "ns", "bytes");
+
+    for (int c = 0; eventCounts[c] > 0; c++) {
+        QList<Entry> events = createEntries(eventCounts[c]);
+
+        measure("appEvents", events.count(), "QJsonDocument", [&] () {
+            return eventsWithJsonDocument(events);
+        });
+        measure("appEvents", events.count(), "QString::arg", [&] () {
+            return eventsWithArg(events);
+        });
+        measure("appEvents", events.count(), "JsonWriter", [&] () {
+            return eventsWithWriter(writer, events);
+        });
+    }
+
+    for (int c = 0; appCounts[c] > 0; c++) {
+        QList<Entry> apps = createEntries(appCounts[c]);
+
+        measure("listRunningApps", apps.count(), "QJsonDocument", [&] () {
+            return appsWithJsonDocument(apps);
+        });
+        measure("listRunningApps", apps.count(), "QString::arg", [&] () {
+            return appsWithArg(apps);
+        });
+        measure("listRunningApps", apps.count(), "JsonWriter", [&] () {
+            return appsWithWriter(writer, apps);
+        });
+    }
+
+    return 0;
+}
@@ -21,6 +21,7 @@
 #include <QtWebKit/private/qquickwebview_p.h>
 
 #include "../webapplicationwindow.h"
+#include "../qmlcomponentcache.h"
 #include "inappbrowserextension.h"
 
 namespace luna
@@ -45,18 +46,25 @@ void InAppBrowserExtension::open(const QString &url, const QString &frameName)
     if (mItem)
         return;
 
-    if (mApplicationWindow->headless())
+    if (mApplicationWindow->headless() || !mApplicationWindow->rootItem())
         return;
 
     qDebug() << Q_FUNC_INFO << url << frameName;
 
     mFrameName = frameName;
 
+    // Restore the viewport mode afterwards as a container might be incubated
+    // at the same time which relies on it
+    bool flickableViewportEnabled = QQuickWebViewExperimental::flickableViewportEnabled();
     QQuickWebViewExperimental::setFlickableViewportEnabled(true);
 
-    QQmlComponent component(mApplicationWindow->qmlEngine(),
-                            QUrl("qrc:///qml/InAppBrowser.qml"));
-    mItem = qobject_cast<QQuickItem *>(component.create());
+    QQmlComponent *component = QmlComponentCache::component(mApplicationWindow->qmlEngine(),
+                                                            QUrl("qrc:///qml/InAppBrowser.qml"));
+    mItem = qobject_cast<QQuickItem *>(component->create(mApplicationWindow->qmlContext()));
+
+    QQuickWebViewExperimental::setFlickableViewportEnabled(flickableViewportEnabled);
+    if (!mItem)
+        return;
     mItem->setParentItem(mApplicationWindow->rootItem());
     mItem->setProperty("url", QVariant(url));
 
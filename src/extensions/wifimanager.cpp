@@ -16,6 +16,7 @@
  */
 
 #include <applicationenvironment.h>
+#include <jsonwriter.h>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
@@ -162,7 +163,7 @@ void WiFiManager::setPowered(bool powered)
 void WiFiManager::retrieveNetworks(int scid, int ecid)
 {
     if (!mWifi) {
-        callback(ecid, "WiFi is not available");
+        callback(ecid, JsonWriter::quote("WiFi is not available"));
         return;
     }
 
@@ -194,10 +195,14 @@ void WiFiManager::finishConnectionProcess(bool success, const QString &error)
 {
     qDebug() << __PRETTY_FUNCTION__;
 
+    QString parameters;
+    if (!error.isEmpty())
+        parameters = JsonWriter::quote(error);
+
     if (mConnecting)
-        callback(success ? mConnectCallbacks.first : mConnectCallbacks.second, error);
+        callback(success ? mConnectCallbacks.first : mConnectCallbacks.second, parameters);
     else if (mDisconnecting)
-        callback(success ? mDisconnectCallbacks.first : mDisconnectCallbacks.second, error);
+        callback(success ? mDisconnectCallbacks.first : mDisconnectCallbacks.second, parameters);
 
     mConnectCallbacks.first = 0;
     mConnectCallbacks.second = 0;
@@ -219,7 +224,7 @@ void WiFiManager::connectNetwork(int scid, int ecid, const QString &network)
     qDebug() << __PRETTY_FUNCTION__ << network;
 
     if (mConnecting) {
-        callback(ecid, "Already connecting to a network");
+        callback(ecid, JsonWriter::quote("Already connecting to a network"));
         return;
     }
 
@@ -228,20 +233,20 @@ void WiFiManager::connectNetwork(int scid, int ecid, const QString &network)
     QJsonDocument document = QJsonDocument::fromJson(network.toUtf8());
 
     if (!document.isObject()) {
-        callback(ecid, "Invalid arguments");
+        callback(ecid, JsonWriter::quote("Invalid arguments"));
         return;
     }
 
     QJsonObject root = document.object();
     if (!root.contains("path") || !root.value("path").isString()) {
-        callback(ecid, "Invalud arguments");
+        callback(ecid, JsonWriter::quote("Invalud arguments"));
         return;
     }
 
     path = root.value("path").toString();
 
     if (!root.contains("password") || !root.value("password").isString()) {
-        callback(ecid, "Invalud arguments");
+        callback(ecid, JsonWriter::quote("Invalud arguments"));
         return;
     }
 
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDebug>
+
+#include "incubationcontroller.h"
+
+#define INCUBATION_FRAME_INTERVAL       16
+#define INCUBATION_DEFAULT_BUDGET       5
+
+namespace luna
+{
+
+static int incubationBudget = INCUBATION_DEFAULT_BUDGET;
+
+IncubationController::IncubationController(QObject *parent) :
+    QObject(parent),
+    mFrameTimer(this)
+{
+    connect(&mFrameTimer, SIGNAL(timeout()), this, SLOT(onFrameTimeout()));
+    mFrameTimer.setInterval(INCUBATION_FRAME_INTERVAL);
+}
+
+void IncubationController::setBudget(int msecs)
+{
+    incubationBudget = qMax(1, msecs);
+}
+
+int IncubationController::budget()
+{
+    return incubationBudget;
+}
+
+void IncubationController::incubatingObjectCountChanged(int count)
+{
+    if (count > 0 && !mFrameTimer.isActive())
+        mFrameTimer.start();
+    else if (count == 0)
+        mFrameTimer.stop();
+}
+
+void IncubationController::onFrameTimeout()
+{
+    incubateFor(incubationBudget);
+}
+
+} // namespace luna
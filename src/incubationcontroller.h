@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef INCUBATIONCONTROLLER_H
+#define INCUBATIONCONTROLLER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QQmlIncubationController>
+
+namespace luna
+{
+
+/*
+ * Drives asynchronous creation of QML objects for an engine. Once every frame
+ * the controller lets the engine incubate objects for a limited amount of time
+ * so that creating the container of a launching application doesn't block the
+ * main loop and with it all the other windows for too long.
+ */
+class IncubationController : public QObject, public QQmlIncubationController
+{
+    Q_OBJECT
+
+public:
+    explicit IncubationController(QObject *parent = 0);
+
+    static void setBudget(int msecs);
+    static int budget();
+
+protected:
+    void incubatingObjectCountChanged(int count);
+
+private Q_SLOTS:
+    void onFrameTimeout();
+
+private:
+    QTimer mFrameTimer;
+};
+
+} // namespace luna
+
+#endif // INCUBATIONCONTROLLER_H
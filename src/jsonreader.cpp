@@ -0,0 +1,822 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#ifdef HAVE_SIMDJSON
+#include <simdjson.h>
+#endif
+
+#include "jsonreader.h"
+
+namespace luna
+{
+
+class JsonReader::Document
+{
+public:
+    Document() :
+        root(NULL)
+    {
+    }
+
+    ~Document()
+    {
+        if (root)
+            j_release(&root);
+    }
+
+#ifdef HAVE_SIMDJSON
+    simdjson::dom::document document;
+#endif
+    jvalue_ref root;
+};
+
+class JsonReader::Node
+{
+public:
+    Node() :
+        valid(false),
+        native(false),
+        value(NULL)
+    {
+    }
+
+    bool valid;
+
+    // Set when the object lives in a document parsed by simdjson; readers
+    // created from a QJsonObject always use the object
+    bool native;
+    QJsonObject object;
+
+    // Set when the object lives in a DOM built by pbnjson which owns it
+    jvalue_ref value;
+#ifdef HAVE_SIMDJSON
+    simdjson::dom::object nativeObject;
+#endif
+};
+
+/* Parameters of the 64 bit FNV-1a hash */
+#define FNV_OFFSET_BASIS    14695981039346656037ULL
+#define FNV_PRIME           1099511628211ULL
+
+static quint64 hashBytes(quint64 hash, const char *data, size_t size)
+{
+    for (size_t n = 0; n < size; n++) {
+        hash ^= (unsigned char) data[n];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static quint64 hashTag(quint64 hash, char tag)
+{
+    return hashBytes(hash, &tag, 1);
+}
+
+static quint64 hashNumber(double value)
+{
+    // Both backends hand out every number as a double so they hash alike
+    return hashBytes(hashTag(FNV_OFFSET_BASIS, 'n'), reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static quint64 hashString(const char *data, size_t size)
+{
+    return hashBytes(hashTag(FNV_OFFSET_BASIS, 's'), data, size);
+}
+
+static quint64 hashMember(const char *key, size_t size, quint64 valueHash)
+{
+    return hashBytes(valueHash, key, size);
+}
+
+static quint64 hashMembers(quint64 memberHashes, int count)
+{
+    // The member hashes are summed up so their order doesn't matter; simdjson
+    // keeps the order of the text while QJsonObject sorts its keys
+    quint64 hash = hashTag(FNV_OFFSET_BASIS, 'o');
+    hash = hashBytes(hash, reinterpret_cast<const char*>(&count), sizeof(count));
+    return hashBytes(hash, reinterpret_cast<const char*>(&memberHashes), sizeof(memberHashes));
+}
+
+static quint64 hashArrayElement(quint64 hash, quint64 elementHash)
+{
+    return hashBytes(hash, reinterpret_cast<const char*>(&elementHash), sizeof(elementHash));
+}
+
+static quint64 hashValue(const QJsonValue &value);
+
+static quint64 hashObject(const QJsonObject &object)
+{
+    quint64 memberHashes = 0;
+    for (QJsonObject::const_iterator it = object.constBegin(); it != object.constEnd(); ++it) {
+        QByteArray key = it.key().toUtf8();
+        memberHashes += hashMember(key.constData(), key.size(), hashValue(it.value()));
+    }
+
+    return hashMembers(memberHashes, object.count());
+}
+
+static quint64 hashValue(const QJsonValue &value)
+{
+    switch (value.type()) {
+    case QJsonValue::Object:
+        return hashObject(value.toObject());
+    case QJsonValue::Array: {
+        quint64 hash = hashTag(FNV_OFFSET_BASIS, 'a');
+        Q_FOREACH(const QJsonValue &element, value.toArray())
+            hash = hashArrayElement(hash, hashValue(element));
+        return hash;
+    }
+    case QJsonValue::String: {
+        QByteArray string = value.toString().toUtf8();
+        return hashString(string.constData(), string.size());
+    }
+    case QJsonValue::Double:
+        return hashNumber(value.toDouble());
+    case QJsonValue::Bool:
+        return hashTag(FNV_OFFSET_BASIS, value.toBool() ? 't' : 'f');
+    default:
+        return hashTag(FNV_OFFSET_BASIS, 'z');
+    }
+}
+
+#ifdef HAVE_SIMDJSON
+
+static bool lookup(const simdjson::dom::object &object, const char *key, simdjson::dom::element &element)
+{
+    return object.at_key(key).get(element) == simdjson::SUCCESS;
+}
+
+static QString toString(std::string_view value)
+{
+    return QString::fromUtf8(value.data(), value.size());
+}
+
+static QJsonValue toJsonValue(const simdjson::dom::element &element);
+
+static QJsonObject toJsonObject(const simdjson::dom::object &members)
+{
+    QJsonObject object;
+    for (simdjson::dom::key_value_pair member : members)
+        object.insert(toString(member.key), toJsonValue(member.value));
+    return object;
+}
+
+static QJsonValue toJsonValue(const simdjson::dom::element &element)
+{
+    simdjson::dom::object members;
+    if (element.get(members) == simdjson::SUCCESS)
+        return toJsonObject(members);
+
+    simdjson::dom::array elements;
+    if (element.get(elements) == simdjson::SUCCESS) {
+        QJsonArray array;
+        for (simdjson::dom::element child : elements)
+            array.append(toJsonValue(child));
+        return array;
+    }
+
+    std::string_view string;
+    if (element.get(string) == simdjson::SUCCESS)
+        return toString(string);
+
+    bool boolean = false;
+    if (element.get(boolean) == simdjson::SUCCESS)
+        return boolean;
+
+    double number = 0;
+    if (element.get(number) == simdjson::SUCCESS)
+        return number;
+
+    return QJsonValue(QJsonValue::Null);
+}
+
+static quint64 hashElement(const simdjson::dom::element &element);
+
+static quint64 hashObject(const simdjson::dom::object &members)
+{
+    quint64 memberHashes = 0;
+    int count = 0;
+    for (simdjson::dom::key_value_pair member : members) {
+        memberHashes += hashMember(member.key.data(), member.key.size(), hashElement(member.value));
+        count++;
+    }
+
+    return hashMembers(memberHashes, count);
+}
+
+static quint64 hashElement(const simdjson::dom::element &element)
+{
+    simdjson::dom::object members;
+    if (element.get(members) == simdjson::SUCCESS)
+        return hashObject(members);
+
+    simdjson::dom::array elements;
+    if (element.get(elements) == simdjson::SUCCESS) {
+        quint64 hash = hashTag(FNV_OFFSET_BASIS, 'a');
+        for (simdjson::dom::element child : elements)
+            hash = hashArrayElement(hash, hashElement(child));
+        return hash;
+    }
+
+    std::string_view string;
+    if (element.get(string) == simdjson::SUCCESS)
+        return hashString(string.data(), string.size());
+
+    bool boolean = false;
+    if (element.get(boolean) == simdjson::SUCCESS)
+        return hashTag(FNV_OFFSET_BASIS, boolean ? 't' : 'f');
+
+    double number = 0;
+    if (element.get(number) == simdjson::SUCCESS)
+        return hashNumber(number);
+
+    return hashTag(FNV_OFFSET_BASIS, 'z');
+}
+
+#endif
+
+static bool lookup(jvalue_ref object, const char *key, jvalue_ref &value)
+{
+    return jobject_get_exists(object, j_cstr_to_buffer(key), &value);
+}
+
+static QString toString(jvalue_ref value)
+{
+    raw_buffer buffer = jstring_get_fast(value);
+    return QString::fromUtf8(buffer.m_str, buffer.m_len);
+}
+
+static QJsonValue toJsonValue(jvalue_ref value);
+
+static QJsonObject toJsonObject(jvalue_ref members)
+{
+    QJsonObject object;
+    jobject_iter it;
+    jobject_key_value member;
+
+    if (!jobject_iter_init(&it, members))
+        return object;
+
+    while (jobject_iter_next(&it, &member))
+        object.insert(toString(member.key), toJsonValue(member.value));
+
+    return object;
+}
+
+static QJsonValue toJsonValue(jvalue_ref value)
+{
+    if (jis_object(value))
+        return toJsonObject(value);
+
+    if (jis_array(value)) {
+        QJsonArray array;
+        for (ssize_t n = 0; n < jarray_size(value); n++)
+            array.append(toJsonValue(jarray_get(value, n)));
+        return array;
+    }
+
+    if (jis_string(value))
+        return toString(value);
+
+    bool boolean = false;
+    if (jis_boolean(value) && jboolean_get(value, &boolean) == CONV_OK)
+        return boolean;
+
+    double number = 0;
+    if (jis_number(value)) {
+        jnumber_get_f64(value, &number);
+        return number;
+    }
+
+    return QJsonValue(QJsonValue::Null);
+}
+
+static quint64 hashJValue(jvalue_ref value);
+
+static quint64 hashJObject(jvalue_ref members)
+{
+    quint64 memberHashes = 0;
+    int count = 0;
+    jobject_iter it;
+    jobject_key_value member;
+
+    if (jobject_iter_init(&it, members)) {
+        while (jobject_iter_next(&it, &member)) {
+            raw_buffer key = jstring_get_fast(member.key);
+            memberHashes += hashMember(key.m_str, key.m_len, hashJValue(member.value));
+            count++;
+        }
+    }
+
+    return hashMembers(memberHashes, count);
+}
+
+static quint64 hashJValue(jvalue_ref value)
+{
+    if (jis_object(value))
+        return hashJObject(value);
+
+    if (jis_array(value)) {
+        quint64 hash = hashTag(FNV_OFFSET_BASIS, 'a');
+        for (ssize_t n = 0; n < jarray_size(value); n++)
+            hash = hashArrayElement(hash, hashJValue(jarray_get(value, n)));
+        return hash;
+    }
+
+    if (jis_string(value)) {
+        raw_buffer string = jstring_get_fast(value);
+        return hashString(string.m_str, string.m_len);
+    }
+
+    bool boolean = false;
+    if (jis_boolean(value) && jboolean_get(value, &boolean) == CONV_OK)
+        return hashTag(FNV_OFFSET_BASIS, boolean ? 't' : 'f');
+
+    double number = 0;
+    if (jis_number(value)) {
+        jnumber_get_f64(value, &number);
+        return hashNumber(number);
+    }
+
+    return hashTag(FNV_OFFSET_BASIS, 'z');
+}
+
+JsonReader::JsonReader() :
+    mNode(new Node)
+{
+}
+
+JsonReader::JsonReader(const char *data, int size) :
+    mNode(new Node)
+{
+    if (!data)
+        return;
+
+    if (size < 0)
+        size = qstrlen(data);
+
+#ifdef HAVE_SIMDJSON
+    // The parser keeps its buffers between payloads. Parsers can't be shared
+    // between threads so every thread gets its own. The document can't be
+    // the parser's own one as readers outlive the next parse on the thread,
+    // so the payload is copied and padded into a document of our own.
+    static thread_local simdjson::dom::parser parser;
+
+    mDocument = QSharedPointer<Document>(new Document);
+
+    simdjson::dom::element root;
+    if (parser.parse_into_document(mDocument->document, data, size).get(root) != simdjson::SUCCESS)
+        return;
+
+    mNode->native = root.get(mNode->nativeObject) == simdjson::SUCCESS;
+    mNode->valid = mNode->native;
+#else
+    QJsonDocument document = QJsonDocument::fromJson(QByteArray::fromRawData(data, size));
+    mNode->object = document.object();
+    mNode->valid = document.isObject();
+#endif
+}
+
+JsonReader::JsonReader(const QByteArray &data) :
+    JsonReader(data.constData(), data.size())
+{
+}
+
+JsonReader::JsonReader(const QJsonObject &object) :
+    mNode(new Node)
+{
+    mNode->object = object;
+    mNode->valid = true;
+}
+
+JsonReader::JsonReader(jvalue_ref value) :
+    mDocument(new Document),
+    mNode(new Node)
+{
+    mDocument->root = value;
+
+    if (value && jis_object(value)) {
+        mNode->value = value;
+        mNode->valid = true;
+    }
+}
+
+bool JsonReader::isValid() const
+{
+    return mNode->valid;
+}
+
+bool JsonReader::contains(const char *key) const
+{
+#ifdef HAVE_SIMDJSON
+    simdjson::dom::element element;
+    if (mNode->native)
+        return lookup(mNode->nativeObject, key, element);
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        return lookup(mNode->value, key, value);
+    }
+
+    return mNode->object.contains(QString::fromLatin1(key));
+}
+
+bool JsonReader::isString(const char *key) const
+{
+#ifdef HAVE_SIMDJSON
+    simdjson::dom::element element;
+    if (mNode->native)
+        return lookup(mNode->nativeObject, key, element) && element.is_string();
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        return lookup(mNode->value, key, value) && jis_string(value);
+    }
+
+    return mNode->object.value(QString::fromLatin1(key)).isString();
+}
+
+bool JsonReader::isBool(const char *key) const
+{
+#ifdef HAVE_SIMDJSON
+    simdjson::dom::element element;
+    if (mNode->native)
+        return lookup(mNode->nativeObject, key, element) && element.is_bool();
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        return lookup(mNode->value, key, value) && jis_boolean(value);
+    }
+
+    return mNode->object.value(QString::fromLatin1(key)).isBool();
+}
+
+bool JsonReader::isNumber(const char *key) const
+{
+#ifdef HAVE_SIMDJSON
+    simdjson::dom::element element;
+    if (mNode->native)
+        return lookup(mNode->nativeObject, key, element) && element.is_number();
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        return lookup(mNode->value, key, value) && jis_number(value);
+    }
+
+    return mNode->object.value(QString::fromLatin1(key)).isDouble();
+}
+
+bool JsonReader::isArray(const char *key) const
+{
+#ifdef HAVE_SIMDJSON
+    simdjson::dom::element element;
+    if (mNode->native)
+        return lookup(mNode->nativeObject, key, element) && element.is_array();
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        return lookup(mNode->value, key, value) && jis_array(value);
+    }
+
+    return mNode->object.value(QString::fromLatin1(key)).isArray();
+}
+
+bool JsonReader::isObject(const char *key) const
+{
+#ifdef HAVE_SIMDJSON
+    simdjson::dom::element element;
+    if (mNode->native)
+        return lookup(mNode->nativeObject, key, element) && element.is_object();
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        return lookup(mNode->value, key, value) && jis_object(value);
+    }
+
+    return mNode->object.value(QString::fromLatin1(key)).isObject();
+}
+
+QString JsonReader::string(const char *key, const QString &defaultValue) const
+{
+#ifdef HAVE_SIMDJSON
+    if (mNode->native) {
+        simdjson::dom::element element;
+        std::string_view value;
+        if (!lookup(mNode->nativeObject, key, element) || element.get(value) != simdjson::SUCCESS)
+            return defaultValue;
+
+        return toString(value);
+    }
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        if (!lookup(mNode->value, key, value) || !jis_string(value))
+            return defaultValue;
+
+        return toString(value);
+    }
+
+    QJsonValue value = mNode->object.value(QString::fromLatin1(key));
+    return value.isString() ? value.toString() : defaultValue;
+}
+
+bool JsonReader::boolean(const char *key, bool defaultValue) const
+{
+#ifdef HAVE_SIMDJSON
+    if (mNode->native) {
+        simdjson::dom::element element;
+        bool value = false;
+        if (!lookup(mNode->nativeObject, key, element) || element.get(value) != simdjson::SUCCESS)
+            return defaultValue;
+
+        return value;
+    }
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        bool result = false;
+        if (!lookup(mNode->value, key, value) || !jis_boolean(value) ||
+            jboolean_get(value, &result) != CONV_OK)
+            return defaultValue;
+
+        return result;
+    }
+
+    QJsonValue value = mNode->object.value(QString::fromLatin1(key));
+    return value.isBool() ? value.toBool() : defaultValue;
+}
+
+qint64 JsonReader::integer(const char *key, qint64 defaultValue) const
+{
+#ifdef HAVE_SIMDJSON
+    if (mNode->native) {
+        simdjson::dom::element element;
+        if (!lookup(mNode->nativeObject, key, element))
+            return defaultValue;
+
+        // Integers are kept exactly; anything else which is a number is
+        // truncated like QJsonValue does it
+        int64_t value = 0;
+        if (element.get(value) == simdjson::SUCCESS)
+            return value;
+
+        double number = 0;
+        if (element.get(number) == simdjson::SUCCESS)
+            return (qint64) number;
+
+        return defaultValue;
+    }
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        if (!lookup(mNode->value, key, value) || !jis_number(value))
+            return defaultValue;
+
+        int64_t result = 0;
+        if (jnumber_get_i64(value, &result) == CONV_OK)
+            return result;
+
+        double number = 0;
+        jnumber_get_f64(value, &number);
+        return (qint64) number;
+    }
+
+    QJsonValue value = mNode->object.value(QString::fromLatin1(key));
+    return value.isDouble() ? (qint64) value.toDouble() : defaultValue;
+}
+
+double JsonReader::number(const char *key, double defaultValue) const
+{
+#ifdef HAVE_SIMDJSON
+    if (mNode->native) {
+        simdjson::dom::element element;
+        double value = 0;
+        if (!lookup(mNode->nativeObject, key, element) || element.get(value) != simdjson::SUCCESS)
+            return defaultValue;
+
+        return value;
+    }
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        double result = 0;
+        if (!lookup(mNode->value, key, value) || !jis_number(value))
+            return defaultValue;
+
+        jnumber_get_f64(value, &result);
+        return result;
+    }
+
+    QJsonValue value = mNode->object.value(QString::fromLatin1(key));
+    return value.isDouble() ? value.toDouble() : defaultValue;
+}
+
+QStringList JsonReader::stringList(const char *key) const
+{
+    QStringList list;
+
+#ifdef HAVE_SIMDJSON
+    if (mNode->native) {
+        simdjson::dom::element element;
+        simdjson::dom::array elements;
+        if (!lookup(mNode->nativeObject, key, element) || element.get(elements) != simdjson::SUCCESS)
+            return list;
+
+        for (simdjson::dom::element child : elements) {
+            std::string_view value;
+            if (child.get(value) == simdjson::SUCCESS)
+                list.append(toString(value));
+        }
+
+        return list;
+    }
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        if (!lookup(mNode->value, key, value) || !jis_array(value))
+            return list;
+
+        for (ssize_t n = 0; n < jarray_size(value); n++) {
+            jvalue_ref child = jarray_get(value, n);
+            if (jis_string(child))
+                list.append(toString(child));
+        }
+
+        return list;
+    }
+
+    Q_FOREACH(const QJsonValue &value, mNode->object.value(QString::fromLatin1(key)).toArray()) {
+        if (value.isString())
+            list.append(value.toString());
+    }
+
+    return list;
+}
+
+JsonReader JsonReader::object(const char *key) const
+{
+    JsonReader reader;
+    reader.mDocument = mDocument;
+
+#ifdef HAVE_SIMDJSON
+    if (mNode->native) {
+        simdjson::dom::element element;
+        if (lookup(mNode->nativeObject, key, element)) {
+            reader.mNode->native = element.get(reader.mNode->nativeObject) == simdjson::SUCCESS;
+            reader.mNode->valid = reader.mNode->native;
+        }
+
+        return reader;
+    }
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        if (lookup(mNode->value, key, value) && jis_object(value)) {
+            reader.mNode->value = value;
+            reader.mNode->valid = true;
+        }
+
+        return reader;
+    }
+
+    QJsonValue value = mNode->object.value(QString::fromLatin1(key));
+    reader.mNode->object = value.toObject();
+    reader.mNode->valid = value.isObject();
+
+    return reader;
+}
+
+QList<JsonReader> JsonReader::objects(const char *key) const
+{
+    // Elements which aren't objects get an invalid reader so the indexes of
+    // the list match the ones of the array
+    QList<JsonReader> readers;
+
+#ifdef HAVE_SIMDJSON
+    if (mNode->native) {
+        simdjson::dom::element element;
+        simdjson::dom::array elements;
+        if (!lookup(mNode->nativeObject, key, element) || element.get(elements) != simdjson::SUCCESS)
+            return readers;
+
+        for (simdjson::dom::element child : elements) {
+            JsonReader reader;
+            reader.mDocument = mDocument;
+            reader.mNode->native = child.get(reader.mNode->nativeObject) == simdjson::SUCCESS;
+            reader.mNode->valid = reader.mNode->native;
+            readers.append(reader);
+        }
+
+        return readers;
+    }
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        if (!lookup(mNode->value, key, value) || !jis_array(value))
+            return readers;
+
+        for (ssize_t n = 0; n < jarray_size(value); n++) {
+            jvalue_ref child = jarray_get(value, n);
+
+            JsonReader reader;
+            reader.mDocument = mDocument;
+            if (jis_object(child)) {
+                reader.mNode->value = child;
+                reader.mNode->valid = true;
+            }
+            readers.append(reader);
+        }
+
+        return readers;
+    }
+
+    Q_FOREACH(const QJsonValue &value, mNode->object.value(QString::fromLatin1(key)).toArray()) {
+        JsonReader reader(value.toObject());
+        reader.mNode->valid = value.isObject();
+        readers.append(reader);
+    }
+
+    return readers;
+}
+
+QJsonValue JsonReader::value(const char *key) const
+{
+#ifdef HAVE_SIMDJSON
+    if (mNode->native) {
+        simdjson::dom::element element;
+        if (!lookup(mNode->nativeObject, key, element))
+            return QJsonValue(QJsonValue::Undefined);
+
+        return toJsonValue(element);
+    }
+#endif
+
+    if (mNode->value) {
+        jvalue_ref value;
+        if (!lookup(mNode->value, key, value))
+            return QJsonValue(QJsonValue::Undefined);
+
+        return toJsonValue(value);
+    }
+
+    return mNode->object.value(QString::fromLatin1(key));
+}
+
+QJsonObject JsonReader::toObject() const
+{
+#ifdef HAVE_SIMDJSON
+    if (mNode->native)
+        return toJsonObject(mNode->nativeObject);
+#endif
+
+    if (mNode->value)
+        return toJsonObject(mNode->value);
+
+    return mNode->object;
+}
+
+quint64 JsonReader::hash() const
+{
+#ifdef HAVE_SIMDJSON
+    if (mNode->native)
+        return hashObject(mNode->nativeObject);
+#endif
+
+    if (mNode->value)
+        return hashJObject(mNode->value);
+
+    return hashObject(mNode->object);
+}
+
+} // namespace luna
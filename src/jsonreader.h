@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef JSONREADER_H
+#define JSONREADER_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+#include <pbnjson.h>
+
+namespace luna
+{
+
+/*
+ * Reads the members of a JSON object from its UTF-8 text. When built with
+ * simdjson the text is parsed with it and strings are only converted to
+ * QString when they're asked for; otherwise QJsonDocument is used. Only parts
+ * which are handed on to code expecting Qt's types are converted with value().
+ * The simdjson document isn't zero-copy: every reader parses into its own
+ * document, which holds a padded copy of the text along with the parsed tape.
+ *
+ * Getters return the default value when the member is missing or has another
+ * type:
+ *
+ *     JsonReader reader(payload);
+ *     if (!reader.isValid())
+ *         return;
+ *     QString appId = reader.string("appId");
+ *     bool subscribe = reader.boolean("subscribe");
+ *
+ * Readers for nested objects share the parsed document with the reader they
+ * were taken from and keep it alive.
+ *
+ * Payloads which were already parsed by pbnjson, like the ones checked
+ * against a schema while they're parsed, are read from the DOM pbnjson built
+ * instead of parsing them again.
+ */
+class JsonReader
+{
+public:
+    JsonReader();
+    explicit JsonReader(const char *data, int size = -1);
+    explicit JsonReader(const QByteArray &data);
+    explicit JsonReader(const QJsonObject &object);
+    // Takes over the reference to the value which is released with the last
+    // reader using it
+    explicit JsonReader(jvalue_ref value);
+
+    bool isValid() const;
+
+    bool contains(const char *key) const;
+    bool isString(const char *key) const;
+    bool isBool(const char *key) const;
+    bool isNumber(const char *key) const;
+    bool isArray(const char *key) const;
+    bool isObject(const char *key) const;
+
+    QString string(const char *key, const QString &defaultValue = QString()) const;
+    bool boolean(const char *key, bool defaultValue = false) const;
+    qint64 integer(const char *key, qint64 defaultValue = 0) const;
+    double number(const char *key, double defaultValue = 0) const;
+    QStringList stringList(const char *key) const;
+
+    JsonReader object(const char *key) const;
+    QList<JsonReader> objects(const char *key) const;
+
+    QJsonValue value(const char *key) const;
+    QJsonObject toObject() const;
+
+    // 64 bit FNV-1a hash of the object which doesn't depend on the order of
+    // its members or on how it was parsed. Cheap enough to recognize an
+    // object seen before without converting or serializing it.
+    quint64 hash() const;
+
+private:
+    class Document;
+    class Node;
+
+    QSharedPointer<Document> mDocument;
+    QSharedPointer<Node> mNode;
+};
+
+} // namespace luna
+
+#endif // JSONREADER_H
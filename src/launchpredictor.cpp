@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMultiMap>
+#include <QStandardPaths>
+
+#include "launchpredictor.h"
+
+#define LAUNCH_PREDICTOR_VERSION            1
+
+/* A transition has to be seen this often and make up this share of all starts
+ * following the same application before it's worth predicting it */
+#define LAUNCH_PREDICTOR_MIN_COUNT          3
+#define LAUNCH_PREDICTOR_MIN_SHARE          0.25
+
+/* Once the starts after one application reach this number all counts for it
+ * are halved so old habits fade out */
+#define LAUNCH_PREDICTOR_DECAY_THRESHOLD    200
+
+namespace luna
+{
+
+LaunchPredictor::LaunchPredictor() :
+    mDirty(false)
+{
+}
+
+void LaunchPredictor::recordStart(const QString &appId)
+{
+    if (appId.isEmpty())
+        return;
+
+    QString previous = mLastAppId;
+    mLastAppId = appId;
+
+    if (previous.isEmpty() || previous == appId)
+        return;
+
+    Transitions &transitions = mTransitions[previous];
+    transitions[appId] += 1;
+
+    int total = 0;
+    Q_FOREACH(int count, transitions.values())
+        total += count;
+
+    if (total >= LAUNCH_PREDICTOR_DECAY_THRESHOLD) {
+        Transitions::iterator iter = transitions.begin();
+        while (iter != transitions.end()) {
+            iter.value() /= 2;
+            if (iter.value() == 0)
+                iter = transitions.erase(iter);
+            else
+                ++iter;
+        }
+    }
+
+    mDirty = true;
+}
+
+QStringList LaunchPredictor::predict(const QString &appId, int count) const
+{
+    QStringList predictions;
+
+    if (!mTransitions.contains(appId) || count <= 0)
+        return predictions;
+
+    const Transitions transitions = mTransitions.value(appId);
+
+    int total = 0;
+    Q_FOREACH(int transitionCount, transitions.values())
+        total += transitionCount;
+
+    // sort the candidates by how often they followed, most likely first
+    QMultiMap<int, QString> candidates;
+    Transitions::const_iterator iter;
+    for (iter = transitions.constBegin(); iter != transitions.constEnd(); ++iter) {
+        if (iter.value() < LAUNCH_PREDICTOR_MIN_COUNT)
+            continue;
+
+        if (iter.value() < total * LAUNCH_PREDICTOR_MIN_SHARE)
+            continue;
+
+        candidates.insert(-iter.value(), iter.key());
+    }
+
+    Q_FOREACH(QString candidate, candidates.values()) {
+        if (predictions.count() >= count)
+            break;
+
+        predictions.append(candidate);
+    }
+
+    return predictions;
+}
+
+QString LaunchPredictor::lastAppId() const
+{
+    return mLastAppId;
+}
+
+bool LaunchPredictor::dirty() const
+{
+    return mDirty;
+}
+
+QString LaunchPredictor::storagePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/launch-transitions.json";
+}
+
+bool LaunchPredictor::load()
+{
+    QFile file(storagePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+    QJsonObject rootObject = document.object();
+
+    if (rootObject.value("version").toInt() != LAUNCH_PREDICTOR_VERSION) {
+        qWarning() << "Ignoring launch transitions with unknown version from" << storagePath();
+        return false;
+    }
+
+    mTransitions.clear();
+
+    QJsonObject transitionsObject = rootObject.value("transitions").toObject();
+    Q_FOREACH(QString from, transitionsObject.keys()) {
+        QJsonObject targets = transitionsObject.value(from).toObject();
+
+        Q_FOREACH(QString to, targets.keys()) {
+            int count = targets.value(to).toDouble();
+            if (count > 0)
+                mTransitions[from].insert(to, count);
+        }
+    }
+
+    mDirty = false;
+
+    qDebug() << __PRETTY_FUNCTION__ << "Loaded launch transitions for" << mTransitions.count() << "applications";
+
+    return true;
+}
+
+bool LaunchPredictor::save()
+{
+    QJsonObject transitionsObject;
+
+    QHash<QString, Transitions>::const_iterator iter;
+    for (iter = mTransitions.constBegin(); iter != mTransitions.constEnd(); ++iter) {
+        QJsonObject targets;
+
+        Transitions::const_iterator target;
+        for (target = iter.value().constBegin(); target != iter.value().constEnd(); ++target)
+            targets.insert(target.key(), target.value());
+
+        transitionsObject.insert(iter.key(), targets);
+    }
+
+    QJsonObject rootObject;
+    rootObject.insert("version", LAUNCH_PREDICTOR_VERSION);
+    rootObject.insert("transitions", transitionsObject);
+
+    QString path = storagePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to store launch transitions in" << path;
+        return false;
+    }
+
+    file.write(QJsonDocument(rootObject).toJson());
+
+    mDirty = false;
+
+    return true;
+}
+
+} // namespace luna
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef LAUNCHPREDICTOR_H
+#define LAUNCHPREDICTOR_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+namespace luna
+{
+
+/*
+ * Counts how often an application was started right after another one and
+ * predicts which applications are likely to be started next. The counts are
+ * kept per application we came from and are halved once they grow too large
+ * so the model follows changes in the usage over time. The model is stored as
+ * JSON in the data location of the manager.
+ */
+class LaunchPredictor
+{
+public:
+    LaunchPredictor();
+
+    void recordStart(const QString &appId);
+    QStringList predict(const QString &appId, int count) const;
+
+    QString lastAppId() const;
+    bool dirty() const;
+
+    bool load();
+    bool save();
+
+    static QString storagePath();
+
+private:
+    typedef QHash<QString, int> Transitions;
+
+    QHash<QString, Transitions> mTransitions;
+    QString mLastAppId;
+    bool mDirty;
+};
+
+} // namespace luna
+
+#endif // LAUNCHPREDICTOR_H
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QJsonDocument>
+
+#include "launchrequest.h"
+#include "launchtimeline.h"
+
+namespace luna
+{
+
+LaunchRequest::LaunchRequest() :
+    mAppDescHash(0),
+    mProcessId(0),
+    mWindowType("card"),
+    mReceivedAt(LaunchTimeline::now())
+{
+}
+
+LaunchRequest::LaunchRequest(const JsonReader &appDesc, const QJsonValue &parameters, int64_t processId) :
+    mAppDesc(appDesc),
+    mAppId(appDesc.string("id")),
+    mAppDescHash(appDesc.hash()),
+    mParameters(parameters),
+    mProcessId(processId),
+    mWindowType("card"),
+    mReceivedAt(LaunchTimeline::now())
+{
+}
+
+JsonReader LaunchRequest::appDesc() const
+{
+    return mAppDesc;
+}
+
+QString LaunchRequest::appId() const
+{
+    return mAppId;
+}
+
+quint64 LaunchRequest::appDescHash() const
+{
+    return mAppDescHash;
+}
+
+QJsonValue LaunchRequest::parameters() const
+{
+    return mParameters;
+}
+
+int64_t LaunchRequest::processId() const
+{
+    return mProcessId;
+}
+
+QUrl LaunchRequest::url() const
+{
+    return mUrl;
+}
+
+void LaunchRequest::setUrl(const QUrl &url)
+{
+    mUrl = url;
+}
+
+QString LaunchRequest::windowType() const
+{
+    return mWindowType;
+}
+
+void LaunchRequest::setWindowType(const QString &windowType)
+{
+    mWindowType = windowType;
+}
+
+qint64 LaunchRequest::receivedAt() const
+{
+    return mReceivedAt;
+}
+
+void LaunchRequest::setReceivedAt(qint64 timestamp)
+{
+    mReceivedAt = timestamp;
+}
+
+QString LaunchRequest::parametersToString(const QJsonValue &parameters)
+{
+    // Parameters can be passed as an already serialized string which is
+    // forwarded to the application as it is
+    if (parameters.isString())
+        return parameters.toString();
+
+    if (parameters.isObject())
+        return QString::fromUtf8(QJsonDocument(parameters.toObject()).toJson(QJsonDocument::Compact));
+
+    return QString("");
+}
+
+} // namespace luna
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef LAUNCHREQUEST_H
+#define LAUNCHREQUEST_H
+
+#include <QJsonValue>
+#include <QString>
+#include <QUrl>
+
+#include <stdint.h>
+
+#include "jsonreader.h"
+
+namespace luna
+{
+
+/*
+ * Carries everything we got with a launchApp or launchUrl call in its already
+ * parsed form from the service to the application, so nothing has to be
+ * serialized and parsed again on the way. The id and hash of the description
+ * are taken when the request is created on the service thread; together they
+ * find an already parsed description.
+ */
+class LaunchRequest
+{
+public:
+    LaunchRequest();
+    LaunchRequest(const JsonReader &appDesc, const QJsonValue &parameters, int64_t processId);
+
+    JsonReader appDesc() const;
+    QString appId() const;
+    quint64 appDescHash() const;
+    QJsonValue parameters() const;
+    int64_t processId() const;
+
+    QUrl url() const;
+    void setUrl(const QUrl &url);
+
+    QString windowType() const;
+    void setWindowType(const QString &windowType);
+
+    qint64 receivedAt() const;
+    void setReceivedAt(qint64 timestamp);
+
+    static QString parametersToString(const QJsonValue &parameters);
+
+private:
+    JsonReader mAppDesc;
+    QString mAppId;
+    quint64 mAppDescHash;
+    QJsonValue mParameters;
+    int64_t mProcessId;
+    QUrl mUrl;
+    QString mWindowType;
+    qint64 mReceivedAt;
+};
+
+} // namespace luna
+
+#endif // LAUNCHREQUEST_H
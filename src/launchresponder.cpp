@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDebug>
+
+#include "launchresponder.h"
+#include "servicerequest.h"
+#include "webapplication.h"
+#include "jsonwriter.h"
+
+namespace luna
+{
+
+LaunchResponder::LaunchResponder(ServiceRequest *request, WebApplication *application,
+                                 RespondOn respondOn, int timeout, QObject *parent) :
+    QObject(parent),
+    mRequest(request),
+    mApplication(application),
+    mProcessId(application->processId()),
+    mPhase(respondOn == RespondOnReady ? LaunchTimeline::PhaseStageReady :
+                                         LaunchTimeline::PhaseLoadSucceeded),
+    mTimeoutTimer(this)
+{
+    // Headless applications never get to the stage so they're ready once
+    // they're loaded
+    if (application->headless())
+        mPhase = LaunchTimeline::PhaseLoadSucceeded;
+
+    // The application was already running or was prelaunched
+    if (respondOn == RespondOnCreated || application->launchTimeline().reached(mPhase)) {
+        respond(true, 0);
+        return;
+    }
+
+    connect(application, SIGNAL(launchPhaseReached(LaunchTimeline::Phase)),
+            this, SLOT(onLaunchPhaseReached(LaunchTimeline::Phase)));
+    connect(application, SIGNAL(closed()), this, SLOT(onApplicationClosed()));
+    connect(application, SIGNAL(loadFailed()), this, SLOT(onLoadFailed()));
+
+    connect(&mTimeoutTimer, SIGNAL(timeout()), this, SLOT(onTimeout()));
+    mTimeoutTimer.setSingleShot(true);
+    mTimeoutTimer.start(timeout);
+}
+
+LaunchResponder::~LaunchResponder()
+{
+    delete mRequest;
+}
+
+bool LaunchResponder::parseRespondOn(const QString &value, RespondOn &respondOn)
+{
+    if (value == "created")
+        respondOn = RespondOnCreated;
+    else if (value == "loaded")
+        respondOn = RespondOnLoaded;
+    else if (value == "ready")
+        respondOn = RespondOnReady;
+    else
+        return false;
+
+    return true;
+}
+
+void LaunchResponder::onLaunchPhaseReached(LaunchTimeline::Phase phase)
+{
+    if (phase != mPhase)
+        return;
+
+    respond(true, 0);
+}
+
+void LaunchResponder::onApplicationClosed()
+{
+    respond(false, "Application was closed before it was ready");
+}
+
+void LaunchResponder::onLoadFailed()
+{
+    respond(false, "Failed to load the application");
+}
+
+void LaunchResponder::onTimeout()
+{
+    qWarning() << "Application with process id" << mProcessId << "didn't reach"
+               << LaunchTimeline::phaseName(mPhase) << "in time";
+
+    respond(false, "Timeout waiting for the application");
+}
+
+void LaunchResponder::respond(bool success, const char *errorText)
+{
+    if (!mRequest)
+        return;
+
+    mTimeoutTimer.stop();
+
+    if (mApplication)
+        mApplication->disconnect(this);
+
+    JsonWriter writer;
+    writer.beginObject();
+    writer.insert("returnValue", success);
+    writer.insert("processId", (qint64) mProcessId);
+    if (errorText)
+        writer.insert("errorText", errorText);
+    writer.endObject();
+
+    mRequest->respond(writer.constData());
+
+    delete mRequest;
+    mRequest = 0;
+
+    deleteLater();
+}
+
+} // namespace luna
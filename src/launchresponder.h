@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef LAUNCHRESPONDER_H
+#define LAUNCHRESPONDER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+#include "launchtimeline.h"
+
+namespace luna
+{
+
+class ServiceRequest;
+class WebApplication;
+
+/*
+ * Holds back the response to a launch request until the launched application
+ * reached the phase the caller asked for, it was closed or the timeout
+ * expired. Deletes itself once it responded.
+ */
+class LaunchResponder : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum RespondOn
+    {
+        RespondOnCreated = 0,
+        RespondOnLoaded,
+        RespondOnReady
+    };
+
+    LaunchResponder(ServiceRequest *request, WebApplication *application,
+                    RespondOn respondOn, int timeout, QObject *parent = 0);
+    ~LaunchResponder();
+
+    static bool parseRespondOn(const QString &value, RespondOn &respondOn);
+
+private Q_SLOTS:
+    void onLaunchPhaseReached(LaunchTimeline::Phase phase);
+    void onApplicationClosed();
+    void onLoadFailed();
+    void onTimeout();
+
+private:
+    ServiceRequest *mRequest;
+    QPointer<WebApplication> mApplication;
+    int64_t mProcessId;
+    LaunchTimeline::Phase mPhase;
+    QTimer mTimeoutTimer;
+
+    void respond(bool success, const char *errorText);
+};
+
+} // namespace luna
+
+#endif // LAUNCHRESPONDER_H
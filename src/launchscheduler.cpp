@@ -0,0 +1,453 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDebug>
+#include <QJsonDocument>
+
+#include "launchscheduler.h"
+#include "launchtimeline.h"
+#include "webappmanager.h"
+#include "webappmanagerservice.h"
+#include "webapplication.h"
+
+#define LAUNCH_SCHEDULER_DEFAULT_CONCURRENCY    2
+
+/* Microseconds after which a queued application which still didn't finish
+ * loading isn't counted against the concurrency limit anymore. Its load might
+ * have failed and it won't ever report it's done. */
+#define LAUNCH_SCHEDULER_IN_FLIGHT_TIMEOUT      (5 * 1000 * 1000)
+
+namespace luna
+{
+
+LaunchScheduler::LaunchScheduler(WebAppManager *webAppManager, QObject *parent) :
+    QObject(parent),
+    mWebAppManager(webAppManager),
+    mProcessTimer(this),
+    mMaxDepth(0),
+    mLaunched(0),
+    mCoalesced(0),
+    mDequeued(0),
+    mTotalWait(0),
+    mMaxWait(0),
+    mMaxConcurrentLaunches(LAUNCH_SCHEDULER_DEFAULT_CONCURRENCY)
+{
+    connect(&mProcessTimer, SIGNAL(timeout()), this, SLOT(onProcessQueue()));
+    mProcessTimer.setSingleShot(true);
+}
+
+LaunchScheduler::Priority LaunchScheduler::priorityFor(const LaunchRequest &request,
+                                                       const ApplicationDescription &desc) const
+{
+    QJsonObject parameters = request.parameters().toObject();
+    if (request.parameters().isString())
+        parameters = QJsonDocument::fromJson(request.parameters().toString().toUtf8()).object();
+
+    if (parameters.value("launchedAtBoot").toBool(false))
+        return PriorityBoot;
+
+    if (desc.headless())
+        return PriorityBackground;
+
+    return PriorityForeground;
+}
+
+LaunchScheduler::Result LaunchScheduler::submit(const LaunchRequest &request, LaunchType type,
+                                                int64_t &processId)
+{
+    bool valid = false;
+    ApplicationDescriptionPtr desc = mWebAppManager->lookupDescription(request, valid);
+
+    if (!valid) {
+        qWarning("Got invalid application description for app %s",
+                 desc->id().toUtf8().constData());
+        return ResultFailed;
+    }
+
+    Priority priority = priorityFor(request, *desc);
+
+    Result result = ResultFailed;
+    if (coalesce(request, desc, priority, processId, result))
+        return result;
+
+    if (deferRelaunch(request, desc, processId))
+        return ResultCoalesced;
+
+    // Foreground cards are what the user is waiting for and relaunching an
+    // already running application is cheap so both don't get queued
+    if (priority == PriorityForeground || mWebAppManager->isAppRunning(desc->id()))
+        return launch(request, desc, type, processId) ? ResultLaunched : ResultFailed;
+
+    enqueue(request, desc, type, priority);
+
+    processId = request.processId();
+
+    return ResultQueued;
+}
+
+QList<LaunchScheduler::BatchResult> LaunchScheduler::submitBatch(const QList<LaunchRequest> &requests)
+{
+    QList<BatchResult> results;
+    QList<int> headless;
+    QList<int> windowed;
+    QList<Priority> priorities;
+    QList<ApplicationDescriptionPtr> descs;
+
+    // Validate everything first so the order below only has to deal with
+    // applications which can actually be launched
+    for (int n = 0; n < requests.count(); n++) {
+        BatchResult result;
+        result.result = ResultFailed;
+        result.processId = requests[n].processId();
+
+        bool valid = false;
+        ApplicationDescriptionPtr desc = mWebAppManager->lookupDescription(requests[n], valid);
+        result.appId = desc->id();
+
+        // Nobody waits for a single application of a batch so none of them
+        // is launched in the foreground
+        Priority priority = PriorityBackground;
+        if (valid) {
+            priority = static_cast<Priority>(qMax(static_cast<int>(priorityFor(requests[n], *desc)),
+                                                  static_cast<int>(PriorityBackground)));
+
+            if (desc->headless())
+                headless.append(n);
+            else
+                windowed.append(n);
+        }
+        else {
+            qWarning() << __PRETTY_FUNCTION__ << "Skipping invalid application description for"
+                       << result.appId;
+        }
+
+        results.append(result);
+        priorities.append(priority);
+        descs.append(desc);
+    }
+
+    // Headless applications are cheap to start so they go first and the
+    // windows are created afterwards
+    Q_FOREACH(int n, headless + windowed) {
+        BatchResult &result = results[n];
+
+        if (coalesce(requests[n], descs[n], priorities[n], result.processId, result.result))
+            continue;
+
+        if (deferRelaunch(requests[n], descs[n], result.processId)) {
+            result.result = ResultCoalesced;
+            continue;
+        }
+
+        if (mWebAppManager->isAppRunning(result.appId)) {
+            result.result = launch(requests[n], descs[n], LaunchTypeApp, result.processId) ?
+                                ResultLaunched : ResultFailed;
+            continue;
+        }
+
+        enqueue(requests[n], descs[n], LaunchTypeApp, priorities[n]);
+        result.result = ResultQueued;
+    }
+
+    return results;
+}
+
+void LaunchScheduler::enqueue(const LaunchRequest &request, const ApplicationDescriptionPtr &desc,
+                              LaunchType type, Priority priority)
+{
+    PendingLaunch pending;
+    pending.request = request;
+    pending.desc = desc;
+    pending.type = type;
+    pending.priority = priority;
+    pending.appId = desc->id();
+    pending.enqueuedAt = LaunchTimeline::now();
+
+    mQueues[priority].append(pending);
+    mMaxDepth = qMax(mMaxDepth, depth());
+
+    qDebug() << __PRETTY_FUNCTION__ << "Queued launch of" << pending.appId
+             << "with priority" << priority << "(queue depth" << depth() << ")";
+
+    if (!mProcessTimer.isActive())
+        mProcessTimer.start(0);
+}
+
+bool LaunchScheduler::coalesce(const LaunchRequest &request, const ApplicationDescriptionPtr &desc,
+                               Priority priority, int64_t &processId, Result &result)
+{
+    QString appId = desc->id();
+
+    for (int n = 0; n < PriorityCount; n++) {
+        for (int m = 0; m < mQueues[n].count(); m++) {
+            if (mQueues[n][m].appId != appId)
+                continue;
+
+            PendingLaunch pending = mQueues[n].takeAt(m);
+
+            // Keep the process id the first caller already got but use the
+            // newest parameters as a relaunch would do
+            LaunchRequest merged(request.appDesc(), request.parameters(), pending.request.processId());
+            merged.setUrl(pending.request.url());
+            merged.setWindowType(pending.request.windowType());
+            merged.setReceivedAt(pending.request.receivedAt());
+            pending.request = merged;
+            pending.desc = desc;
+            pending.priority = static_cast<Priority>(qMin(static_cast<int>(pending.priority),
+                                                          static_cast<int>(priority)));
+
+            mCoalesced++;
+            processId = pending.request.processId();
+
+            qDebug() << __PRETTY_FUNCTION__ << "Merged launch request for" << appId
+                     << "into already queued one";
+
+            // A foreground request for a queued application can't wait any longer
+            if (pending.priority == PriorityForeground) {
+                mDequeued++;
+                qint64 wait = LaunchTimeline::now() - pending.enqueuedAt;
+                mTotalWait += wait;
+                mMaxWait = qMax(mMaxWait, wait);
+
+                result = launch(pending.request, pending.desc, pending.type, processId) ?
+                             ResultLaunched : ResultFailed;
+                return true;
+            }
+
+            mQueues[pending.priority].append(pending);
+            result = ResultCoalesced;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool LaunchScheduler::deferRelaunch(const LaunchRequest &request, const ApplicationDescriptionPtr &desc,
+                                    int64_t &processId)
+{
+    // Relaunching an application while its window is still being built and
+    // its page loads gets its parameters lost or handled twice, so only the
+    // newest ones are kept and the application is relaunched once with them
+    // when it's loaded
+    WebApplication *app = mWebAppManager->applicationByAppId(desc->id());
+    if (!app || !mLoading.contains(app))
+        return false;
+
+    mPendingRelaunches.insert(app, request.parameters());
+
+    mCoalesced++;
+    processId = app->processId();
+
+    qDebug() << __PRETTY_FUNCTION__ << "Merged launch request for" << desc->id()
+             << "into the one still loading";
+
+    return true;
+}
+
+bool LaunchScheduler::launch(const LaunchRequest &request, const ApplicationDescriptionPtr &desc,
+                             LaunchType type, int64_t &processId)
+{
+    // Running and prelaunched applications are relaunched or adopted; only
+    // the ones we create here are watched until they're loaded
+    bool created = !mWebAppManager->applicationByAppId(desc->id());
+
+    WebApplication *app = 0;
+
+    if (type == LaunchTypeUrl)
+        app = mWebAppManager->launchUrl(request, desc);
+    else
+        app = mWebAppManager->launchApp(request, desc);
+
+    if (!app)
+        return false;
+
+    mLaunched++;
+    processId = app->processId();
+
+    if (created && !app->launchTimeline().reached(LaunchTimeline::PhaseLoadSucceeded) &&
+        !mLoading.contains(app)) {
+        mLoading.insert(app);
+        connect(app, SIGNAL(launchPhaseReached(LaunchTimeline::Phase)),
+                this, SLOT(onLaunchPhaseReached(LaunchTimeline::Phase)));
+        connect(app, SIGNAL(loadFailed()), this, SLOT(onLoadFailed()));
+        connect(app, SIGNAL(closed()), this, SLOT(onApplicationClosed()));
+    }
+
+    return true;
+}
+
+void LaunchScheduler::onProcessQueue()
+{
+    expireInFlight();
+
+    // Wait for one of the loading applications to finish before we start
+    // the next one; finishing or expiring restarts the queue
+    if (mInFlight.count() >= mMaxConcurrentLaunches) {
+        if (!mProcessTimer.isActive())
+            mProcessTimer.start(LAUNCH_SCHEDULER_IN_FLIGHT_TIMEOUT / 1000);
+        return;
+    }
+
+    for (int n = 0; n < PriorityCount; n++) {
+        if (mQueues[n].isEmpty())
+            continue;
+
+        PendingLaunch pending = mQueues[n].takeFirst();
+
+        qint64 wait = LaunchTimeline::now() - pending.enqueuedAt;
+        mDequeued++;
+        mTotalWait += wait;
+        mMaxWait = qMax(mMaxWait, wait);
+
+        qDebug() << __PRETTY_FUNCTION__ << "Launching queued application" << pending.appId
+                 << "after waiting" << wait / 1000 << "ms";
+
+        int64_t processId = 0;
+        if (!launch(pending.request, pending.desc, pending.type, processId)) {
+            qWarning() << "Failed to launch queued application" << pending.appId;
+
+            // The caller was told the launch was queued a while ago
+            mWebAppManager->service()->notifyAppLaunchFailed(pending.appId, pending.request.processId());
+            break;
+        }
+
+        WebApplication *app = mWebAppManager->applicationByProcessId(processId);
+        if (app && mLoading.contains(app) && !mInFlight.contains(app))
+            mInFlight.insert(app, LaunchTimeline::now());
+
+        break;
+    }
+
+    // only launch one application per main loop iteration
+    if (depth() > 0)
+        mProcessTimer.start(0);
+}
+
+void LaunchScheduler::onLaunchPhaseReached(LaunchTimeline::Phase phase)
+{
+    if (phase != LaunchTimeline::PhaseLoadSucceeded)
+        return;
+
+    finishLoading(static_cast<WebApplication*>(sender()), true);
+}
+
+void LaunchScheduler::onLoadFailed()
+{
+    finishLoading(static_cast<WebApplication*>(sender()), false);
+}
+
+void LaunchScheduler::onApplicationClosed()
+{
+    finishLoading(static_cast<WebApplication*>(sender()), false);
+}
+
+void LaunchScheduler::finishLoading(WebApplication *app, bool loaded)
+{
+    if (!mLoading.remove(app))
+        return;
+
+    disconnect(app, 0, this, 0);
+
+    // A page which failed to load has nobody to hand the parameters to
+    if (mPendingRelaunches.contains(app)) {
+        QJsonValue parameters = mPendingRelaunches.take(app);
+        if (loaded)
+            app->relaunch(LaunchRequest::parametersToString(parameters));
+    }
+
+    if (mInFlight.remove(app) && depth() > 0)
+        mProcessTimer.start(0);
+}
+
+void LaunchScheduler::expireInFlight()
+{
+    qint64 now = LaunchTimeline::now();
+
+    QHash<WebApplication*, qint64>::iterator it = mInFlight.begin();
+    while (it != mInFlight.end()) {
+        if (now - it.value() < LAUNCH_SCHEDULER_IN_FLIGHT_TIMEOUT) {
+            ++it;
+            continue;
+        }
+
+        qWarning() << __PRETTY_FUNCTION__ << "Application" << it.key()->id()
+                   << "is still loading, not waiting for it anymore";
+
+        // It's still watched so launches of it keep being merged until it's
+        // loaded or failed to
+        it = mInFlight.erase(it);
+    }
+}
+
+void LaunchScheduler::setMaxConcurrentLaunches(int count)
+{
+    mMaxConcurrentLaunches = qMax(1, count);
+
+    if (depth() > 0)
+        mProcessTimer.start(0);
+}
+
+int LaunchScheduler::maxConcurrentLaunches() const
+{
+    return mMaxConcurrentLaunches;
+}
+
+int LaunchScheduler::inFlight() const
+{
+    return mInFlight.count();
+}
+
+int LaunchScheduler::depth() const
+{
+    int depth = 0;
+
+    for (int n = 0; n < PriorityCount; n++)
+        depth += mQueues[n].count();
+
+    return depth;
+}
+
+int LaunchScheduler::maxDepth() const
+{
+    return mMaxDepth;
+}
+
+int LaunchScheduler::launched() const
+{
+    return mLaunched;
+}
+
+int LaunchScheduler::coalesced() const
+{
+    return mCoalesced;
+}
+
+qint64 LaunchScheduler::averageWait() const
+{
+    if (mDequeued == 0)
+        return 0;
+
+    return mTotalWait / mDequeued / 1000;
+}
+
+qint64 LaunchScheduler::maxWait() const
+{
+    return mMaxWait / 1000;
+}
+
+} // namespace luna
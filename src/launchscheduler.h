@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef LAUNCHSCHEDULER_H
+#define LAUNCHSCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QJsonValue>
+#include <QList>
+#include <QSet>
+#include <QTimer>
+
+#include "applicationdescriptioncache.h"
+#include "launchrequest.h"
+#include "launchtimeline.h"
+
+namespace luna
+{
+
+class WebAppManager;
+class WebApplication;
+
+/*
+ * Sits in front of WebAppManager::launchApp and WebAppManager::launchUrl.
+ * Foreground cards are launched right away while headless applications and
+ * those launched at boot are queued and launched one per main loop iteration
+ * so they don't block the foreground card. Requests for an application which
+ * is already queued are merged into the queued one. Requests for one we
+ * launched which is still loading are merged as well and only its newest
+ * parameters are handed to it once it's loaded. The description of the
+ * application is looked up once when the request is submitted and handed on
+ * with the launch.
+ *
+ * Only a limited number of queued applications are loading at the same time
+ * so a burst of launches at boot doesn't starve the ones already started.
+ * Queued launches which fail are reported with a "fail" application event as
+ * their callers got their response long before.
+ */
+class LaunchScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Priority
+    {
+        PriorityForeground = 0,
+        PriorityBackground,
+        PriorityBoot,
+        PriorityCount
+    };
+
+    enum LaunchType
+    {
+        LaunchTypeApp = 0,
+        LaunchTypeUrl
+    };
+
+    enum Result
+    {
+        ResultLaunched = 0,
+        ResultQueued,
+        // Merged into a launch which is still queued or still loading;
+        // merging into a queued one which then had to be started right away
+        // reports how that launch went
+        ResultCoalesced,
+        ResultFailed
+    };
+
+    struct BatchResult
+    {
+        QString appId;
+        Result result;
+        int64_t processId;
+    };
+
+    explicit LaunchScheduler(WebAppManager *webAppManager, QObject *parent = 0);
+
+    Result submit(const LaunchRequest &request, LaunchType type, int64_t &processId);
+    QList<BatchResult> submitBatch(const QList<LaunchRequest> &requests);
+
+    void setMaxConcurrentLaunches(int count);
+    int maxConcurrentLaunches() const;
+    int inFlight() const;
+
+    int depth() const;
+    int maxDepth() const;
+    int launched() const;
+    int coalesced() const;
+    qint64 averageWait() const;
+    qint64 maxWait() const;
+
+private Q_SLOTS:
+    void onProcessQueue();
+    void onLaunchPhaseReached(LaunchTimeline::Phase phase);
+    void onLoadFailed();
+    void onApplicationClosed();
+
+private:
+    struct PendingLaunch
+    {
+        LaunchRequest request;
+        ApplicationDescriptionPtr desc;
+        LaunchType type;
+        Priority priority;
+        QString appId;
+        qint64 enqueuedAt;
+    };
+
+    WebAppManager *mWebAppManager;
+    QList<PendingLaunch> mQueues[PriorityCount];
+    QTimer mProcessTimer;
+    int mMaxDepth;
+    int mLaunched;
+    int mCoalesced;
+    int mDequeued;
+    qint64 mTotalWait;
+    qint64 mMaxWait;
+    int mMaxConcurrentLaunches;
+    QHash<WebApplication*, qint64> mInFlight;
+    // Applications we created which didn't finish their first load yet, with
+    // the newest parameters they were launched with again in the meantime
+    QSet<WebApplication*> mLoading;
+    QHash<WebApplication*, QJsonValue> mPendingRelaunches;
+
+    Priority priorityFor(const LaunchRequest &request, const ApplicationDescription &desc) const;
+    bool coalesce(const LaunchRequest &request, const ApplicationDescriptionPtr &desc, Priority priority,
+                  int64_t &processId, Result &result);
+    bool deferRelaunch(const LaunchRequest &request, const ApplicationDescriptionPtr &desc,
+                       int64_t &processId);
+    bool launch(const LaunchRequest &request, const ApplicationDescriptionPtr &desc, LaunchType type,
+                int64_t &processId);
+    void enqueue(const LaunchRequest &request, const ApplicationDescriptionPtr &desc, LaunchType type,
+                 Priority priority);
+    void expireInFlight();
+    void finishLoading(WebApplication *app, bool loaded);
+};
+
+} // namespace luna
+
+#endif // LAUNCHSCHEDULER_H
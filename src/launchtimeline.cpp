@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QStringList>
+
+#include <time.h>
+
+#include "launchtimeline.h"
+
+namespace luna
+{
+
+static const char *phaseNames[LaunchTimeline::PhaseCount] = {
+    "received",
+    "descriptionParsed",
+    "windowCreated",
+    "containerLoaded",
+    "webViewConfigured",
+    "loadStarted",
+    "loadSucceeded",
+    "stageReady",
+    "revealed",
+    "firstFrame"
+};
+
+LaunchTimeline::LaunchTimeline()
+{
+    for (int n = 0; n < PhaseCount; n++)
+        mTimestamps[n] = -1;
+}
+
+qint64 LaunchTimeline::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<qint64>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+const char* LaunchTimeline::phaseName(Phase phase)
+{
+    if (phase < 0 || phase >= PhaseCount)
+        return "unknown";
+
+    return phaseNames[phase];
+}
+
+void LaunchTimeline::mark(Phase phase)
+{
+    mark(phase, now());
+}
+
+void LaunchTimeline::mark(Phase phase, qint64 timestamp)
+{
+    if (phase < 0 || phase >= PhaseCount || timestamp < 0)
+        return;
+
+    if (mTimestamps[phase] >= 0)
+        return;
+
+    mTimestamps[phase] = timestamp;
+}
+
+QString LaunchTimeline::revealReason() const
+{
+    return mRevealReason;
+}
+
+void LaunchTimeline::setRevealReason(const QString &reason)
+{
+    mRevealReason = reason;
+}
+
+bool LaunchTimeline::reached(Phase phase) const
+{
+    return mTimestamps[phase] >= 0;
+}
+
+qint64 LaunchTimeline::timestamp(Phase phase) const
+{
+    return mTimestamps[phase];
+}
+
+qint64 LaunchTimeline::elapsed(Phase phase) const
+{
+    if (!reached(phase) || !reached(PhaseReceived))
+        return -1;
+
+    return mTimestamps[phase] - mTimestamps[PhaseReceived];
+}
+
+QString LaunchTimeline::summary() const
+{
+    QStringList parts;
+
+    for (int n = 0; n < PhaseCount; n++) {
+        Phase phase = static_cast<Phase>(n);
+        if (!reached(phase))
+            continue;
+
+        parts << QString("%1=%2ms").arg(phaseName(phase)).arg(elapsed(phase) / 1000.0, 0, 'f', 1);
+    }
+
+    if (!mRevealReason.isEmpty())
+        parts << QString("revealReason=%1").arg(mRevealReason);
+
+    return parts.join(" ");
+}
+
+QJsonObject LaunchTimeline::toJson() const
+{
+    QJsonObject phases;
+
+    for (int n = 0; n < PhaseCount; n++) {
+        Phase phase = static_cast<Phase>(n);
+        if (!reached(phase))
+            continue;
+
+        phases.insert(phaseName(phase), elapsed(phase) / 1000.0);
+    }
+
+    QJsonObject timeline;
+    timeline.insert("startedAt", timestamp(PhaseReceived));
+    timeline.insert("phases", phases);
+
+    if (!mRevealReason.isEmpty())
+        timeline.insert("revealReason", mRevealReason);
+
+    return timeline;
+}
+
+} // namespace luna
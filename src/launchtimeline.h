@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef LAUNCHTIMELINE_H
+#define LAUNCHTIMELINE_H
+
+#include <QString>
+#include <QJsonObject>
+
+namespace luna
+{
+
+/*
+ * Records when an application passed the different phases of its launch.
+ * Timestamps are taken from the monotonic clock in microseconds and only the
+ * first time a phase is reached is recorded.
+ */
+class LaunchTimeline
+{
+public:
+    enum Phase
+    {
+        PhaseReceived = 0,
+        PhaseDescriptionParsed,
+        PhaseWindowCreated,
+        PhaseContainerLoaded,
+        PhaseWebViewConfigured,
+        PhaseLoadStarted,
+        PhaseLoadSucceeded,
+        PhaseStageReady,
+        PhaseRevealed,
+        PhaseFirstFrame,
+        PhaseCount
+    };
+
+    LaunchTimeline();
+
+    void mark(Phase phase);
+    void mark(Phase phase, qint64 timestamp);
+
+    QString revealReason() const;
+    void setRevealReason(const QString &reason);
+
+    bool reached(Phase phase) const;
+    qint64 timestamp(Phase phase) const;
+    qint64 elapsed(Phase phase) const;
+
+    QString summary() const;
+    QJsonObject toJson() const;
+
+    static qint64 now();
+    static const char* phaseName(Phase phase);
+
+private:
+    qint64 mTimestamps[PhaseCount];
+    QString mRevealReason;
+};
+
+} // namespace luna
+
+#endif // LAUNCHTIMELINE_H
@@ -16,8 +16,20 @@
 *
 * LICENSE@@@ */
 
+#include <glib.h>
+
 #include "lunaserviceutils.h"
 
+/* Compiled schemas of all methods by name. Schemas are only parsed once when
+ * they're registered instead of for every message. */
+static GHashTable *method_schemas = NULL;
+
+static void schema_free(gpointer data)
+{
+	jschema_ref schema = (jschema_ref) data;
+	jschema_release(&schema);
+}
+
 void luna_service_message_reply_custom_error(LSHandle *handle, LSMessage *message, const char *error_text)
 {
 	bool ret;
@@ -74,47 +86,81 @@ void luna_service_message_reply_success(LSHandle *handle, LSMessage *message)
 	}
 }
 
+bool luna_service_schema_register(const char *method, const char *schema)
+{
+	jschema_ref compiled_schema = NULL;
+
+	compiled_schema = jschema_parse(j_cstr_to_buffer(schema), DOMOPT_NOOPT, NULL);
+	if (!compiled_schema) {
+		g_warning("Failed to parse schema for method %s", method);
+		return false;
+	}
+
+	if (!method_schemas)
+		method_schemas = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, schema_free);
+
+	g_hash_table_replace(method_schemas, g_strdup(method), compiled_schema);
+
+	return true;
+}
+
+jschema_ref luna_service_schema_lookup(const char *method)
+{
+	jschema_ref schema = NULL;
+
+	if (method_schemas && method)
+		schema = (jschema_ref) g_hash_table_lookup(method_schemas, method);
+
+	/* jschema_all is a static schema accepting everything so it doesn't
+	 * have to be parsed or released */
+	return schema ? schema : jschema_all();
+}
+
+void luna_service_schema_release_all(void)
+{
+	if (!method_schemas)
+		return;
+
+	g_hash_table_destroy(method_schemas);
+	method_schemas = NULL;
+}
+
 jvalue_ref luna_service_message_parse_and_validate(const char *payload)
 {
-	jschema_ref input_schema = NULL;
+	return luna_service_message_parse_and_validate_method(NULL, payload);
+}
+
+jvalue_ref luna_service_message_parse_and_validate_method(const char *method, const char *payload)
+{
 	jvalue_ref parsed_obj = NULL;
 	JSchemaInfo schema_info;
 
-	input_schema = jschema_parse(j_cstr_to_buffer("{}"), DOMOPT_NOOPT, NULL);
-	jschema_info_init(&schema_info, input_schema, NULL, NULL);
+	jschema_info_init(&schema_info, luna_service_schema_lookup(method), NULL, NULL);
 
 	parsed_obj = jdom_parse(j_cstr_to_buffer(payload), DOMOPT_NOOPT, &schema_info);
 
-	jschema_release(&input_schema);
-	if (jis_null(parsed_obj))
+	if (!jis_valid(parsed_obj) || jis_null(parsed_obj)) {
+		j_release(&parsed_obj);
 		return NULL;
+	}
 
 	return parsed_obj;
 }
 
 bool luna_service_message_validate_and_send(LSHandle *handle, LSMessage *message, jvalue_ref reply_obj)
 {
-	jschema_ref response_schema = NULL;
 	LSError lserror;
 	bool success = true;
 
 	LSErrorInit(&lserror);
 
-	response_schema = jschema_parse (j_cstr_to_buffer("{}"), DOMOPT_NOOPT, NULL);
-	if(!response_schema) {
-		luna_service_message_reply_error_internal(handle, message);
-		return false;
-	}
-
 	if (!LSMessageReply(handle, message,
-					jvalue_tostring(reply_obj, response_schema), &lserror)) {
+					jvalue_tostring(reply_obj, jschema_all()), &lserror)) {
 		LSErrorPrint(&lserror, stderr);
 		LSErrorFree(&lserror);
 		success = false;
 	}
 
-	jschema_release(&response_schema);
-
 	return success;
 }
 
@@ -137,24 +183,15 @@ bool luna_service_check_for_subscription_and_process(LSHandle *handle, LSMessage
 
 void luna_service_post_subscription(LSHandle *handle, const char *path, const char *method, jvalue_ref reply_obj)
 {
-	jschema_ref response_schema = NULL;
 	LSError lserror;
 
 	LSErrorInit(&lserror);
 
-	response_schema = jschema_parse (j_cstr_to_buffer("{}"), DOMOPT_NOOPT, NULL);
-	if(!response_schema)
-		goto cleanup;
-
 	if (!LSSubscriptionPost(handle, path, method,
-						jvalue_tostring(reply_obj, response_schema), &lserror)) {
+						jvalue_tostring(reply_obj, jschema_all()), &lserror)) {
 		LSErrorPrint(&lserror, stderr);
 		LSErrorFree(&lserror);
 	}
-
-cleanup:
-	if (response_schema)
-		jschema_release(&response_schema);
 }
 
 // vim:ts=4:sw=4:noexpandtab
@@ -30,7 +30,12 @@ void luna_service_message_reply_error_not_implemented(LSHandle *handle, LSMessag
 void luna_service_message_reply_error_internal(LSHandle *handle, LSMessage *message);
 void luna_service_message_reply_success(LSHandle *handle, LSMessage *message);
 
+bool luna_service_schema_register(const char *method, const char *schema);
+jschema_ref luna_service_schema_lookup(const char *method);
+void luna_service_schema_release_all(void);
+
 jvalue_ref luna_service_message_parse_and_validate(const char *payload);
+jvalue_ref luna_service_message_parse_and_validate_method(const char *method, const char *payload);
 bool luna_service_message_validate_and_send(LSHandle *handle, LSMessage *message, jvalue_ref reply_obj);
 bool luna_service_check_for_subscription_and_process(LSHandle *handle, LSMessage *message);
 void luna_service_post_subscription(LSHandle *handle, const char *path, const char *method, jvalue_ref reply_obj);
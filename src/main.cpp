@@ -27,6 +27,12 @@
 
 #include "webappmanager.h"
 #include "systemtime.h"
+#include "windowpool.h"
+#include "sparewebprocess.h"
+#include "webapplicationwindow.h"
+#include "incubationcontroller.h"
+#include "prelauncher.h"
+#include "launchscheduler.h"
 
 #define VERSION "0.1"
 #define XDG_RUNTIME_DIR_DEFAULT "/tmp/luna-session"
@@ -34,12 +40,39 @@
 static gboolean option_version = FALSE;
 static gboolean option_verbose = FALSE;
 static gboolean option_systemd = FALSE;
+static gint option_window_pool_size = -1;
+static gboolean option_no_spare_web_process = FALSE;
+static gboolean option_no_reveal_on_first_paint = FALSE;
+static gboolean option_shared_qml_engine = FALSE;
+static gint option_incubation_budget = -1;
+static gboolean option_no_splash = FALSE;
+static gint option_prelaunch_count = -1;
+static gint option_prelaunch_memory_budget = -1;
+static gint option_max_concurrent_launches = -1;
 
 static GOptionEntry options[] = {
     { "verbose", 0, 0, G_OPTION_ARG_NONE, &option_verbose, "Enable verbose logging" },
     { "version", 'v', 0, G_OPTION_ARG_NONE, &option_version,
         "Show version information and exit" },
     { "systemd", 0, 0, G_OPTION_ARG_NONE, &option_systemd, "Start with systemd support" },
+    { "window-pool-size", 0, 0, G_OPTION_ARG_INT, &option_window_pool_size,
+        "Number of application windows to keep pre-created for fast launches" },
+    { "no-spare-web-process", 0, 0, G_OPTION_ARG_NONE, &option_no_spare_web_process,
+        "Don't keep a spare web process around for the next launch" },
+    { "no-reveal-on-first-paint", 0, 0, G_OPTION_ARG_NONE, &option_no_reveal_on_first_paint,
+        "Only show windows of preparing applications on stageReady or when the timeout expires" },
+    { "shared-qml-engine", 0, 0, G_OPTION_ARG_NONE, &option_shared_qml_engine,
+        "Use a single QML engine for all application windows" },
+    { "incubation-budget", 0, 0, G_OPTION_ARG_INT, &option_incubation_budget,
+        "Time in milliseconds spent per frame on creating application containers" },
+    { "no-splash", 0, 0, G_OPTION_ARG_NONE, &option_no_splash,
+        "Don't show a splash with the application icon until the content is ready" },
+    { "prelaunch-count", 0, 0, G_OPTION_ARG_INT, &option_prelaunch_count,
+        "Number of likely next applications to prelaunch in the background (0 to disable)" },
+    { "prelaunch-memory-budget", 0, 0, G_OPTION_ARG_INT, &option_prelaunch_memory_budget,
+        "Available memory in MB below which no applications are prelaunched" },
+    { "max-concurrent-launches", 0, 0, G_OPTION_ARG_INT, &option_max_concurrent_launches,
+        "Number of queued applications which are allowed to load at the same time" },
     { NULL },
 };
 
@@ -120,6 +153,33 @@ int main(int argc, char **argv)
         goto cleanup;
     }
 
+    if (option_incubation_budget > 0)
+        luna::IncubationController::setBudget(option_incubation_budget);
+
+    if (option_shared_qml_engine)
+        webAppManager.windowPool()->setSharedEngineEnabled(true);
+
+    if (option_window_pool_size >= 0)
+        webAppManager.windowPool()->setSize(option_window_pool_size);
+
+    if (option_no_spare_web_process)
+        webAppManager.spareWebProcess()->setEnabled(false);
+
+    if (option_no_reveal_on_first_paint)
+        luna::WebApplicationWindow::setRevealOnFirstPaint(false);
+
+    if (option_no_splash)
+        luna::WebApplicationWindow::setSplashEnabled(false);
+
+    if (option_prelaunch_count >= 0)
+        webAppManager.prelauncher()->setMaxApplications(option_prelaunch_count);
+
+    if (option_prelaunch_memory_budget >= 0)
+        webAppManager.prelauncher()->setMemoryBudget(option_prelaunch_memory_budget);
+
+    if (option_max_concurrent_launches > 0)
+        webAppManager.launchScheduler()->setMaxConcurrentLaunches(option_max_concurrent_launches);
+
     if (QFile::exists("/var/luna/dev-mode-enabled"))
         setenv("QTWEBKIT_INSPECTOR_SERVER", "1122", 0);
 
@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDebug>
+#include <QFile>
+
+#include "prelauncher.h"
+#include "launchtimeline.h"
+#include "launchscheduler.h"
+#include "webappmanager.h"
+#include "webapplication.h"
+
+#define PRELAUNCH_DEFAULT_MAX_APPLICATIONS      2
+
+/* Minimum amount of available memory in megabytes required to keep
+ * prelaunched applications around */
+#define PRELAUNCH_DEFAULT_MEMORY_BUDGET         200
+
+/* Time without any launch before we consider the system idle and time between
+ * two prelaunches so they don't pile up */
+#define PRELAUNCH_IDLE_DELAY                    5000
+#define PRELAUNCH_NEXT_DELAY                    2000
+
+/* Prelaunched applications which weren't adopted within this time are thrown
+ * away again */
+#define PRELAUNCH_EXPIRY                        (5 * 60 * 1000)
+
+/* A hinted launch follows within a few hundred milliseconds if it follows at
+ * all */
+#define PRELAUNCH_HINT_EXPIRY                   3000
+
+/* Changes to the launch model are written out at most this often */
+#define PRELAUNCH_SAVE_DELAY                    60000
+
+namespace luna
+{
+
+Prelauncher::Prelauncher(WebAppManager *webAppManager, QObject *parent) :
+    QObject(parent),
+    mWebAppManager(webAppManager),
+    mIdleTimer(this),
+    mExpireTimer(this),
+    mSaveTimer(this),
+    mMaxApplications(PRELAUNCH_DEFAULT_MAX_APPLICATIONS),
+    mMemoryBudget(PRELAUNCH_DEFAULT_MEMORY_BUDGET),
+    mNextProcessId(-1),
+    mPrelaunched(0),
+    mHits(0),
+    mDiscarded(0),
+    mHints(0),
+    mHintHits(0)
+{
+    connect(&mIdleTimer, SIGNAL(timeout()), this, SLOT(onIdleTimeout()));
+    mIdleTimer.setSingleShot(true);
+
+    connect(&mExpireTimer, SIGNAL(timeout()), this, SLOT(onExpireTimeout()));
+    mExpireTimer.setSingleShot(true);
+
+    connect(&mSaveTimer, SIGNAL(timeout()), this, SLOT(onSaveTimeout()));
+    mSaveTimer.setSingleShot(true);
+
+    mPredictor.load();
+}
+
+Prelauncher::~Prelauncher()
+{
+    if (mPredictor.dirty())
+        mPredictor.save();
+}
+
+void Prelauncher::setMaxApplications(int count)
+{
+    mMaxApplications = qMax(0, count);
+
+    if (mMaxApplications == 0) {
+        mIdleTimer.stop();
+        discardAll();
+    }
+}
+
+int Prelauncher::maxApplications() const
+{
+    return mMaxApplications;
+}
+
+void Prelauncher::setMemoryBudget(int megabytes)
+{
+    mMemoryBudget = qMax(0, megabytes);
+}
+
+int Prelauncher::memoryBudget() const
+{
+    return mMemoryBudget;
+}
+
+bool Prelauncher::hint(const QString &appId)
+{
+    mHints++;
+
+    // Already waiting for us so just make sure it stays a bit longer
+    if (mEntries.contains(appId)) {
+        Entry &entry = mEntries[appId];
+        entry.expiresAt = qMax(entry.expiresAt, LaunchTimeline::now() / 1000 + PRELAUNCH_HINT_EXPIRY);
+        scheduleExpiry();
+        return true;
+    }
+
+    if (mWebAppManager->isAppRunning(appId))
+        return true;
+
+    if (mMaxApplications == 0)
+        return false;
+
+    qint64 available = availableMemory();
+    if (available >= 0 && available < mMemoryBudget) {
+        qDebug() << __PRETTY_FUNCTION__ << "Only" << available << "MB of memory available, ignoring hint";
+        return false;
+    }
+
+    // Hints count against the same limit as our own prelaunches. A launcher
+    // hinting at one icon after the other is only going to launch the last
+    // one, so older hints go first and predictions only when there are none.
+    while (mEntries.count() >= mMaxApplications) {
+        QString oldest = oldestEntry(true);
+        if (oldest.isEmpty())
+            oldest = oldestEntry(false);
+
+        discard(oldest);
+    }
+
+    return prelaunch(appId, true);
+}
+
+bool Prelauncher::cancel(const QString &appId)
+{
+    // Applications we prelaunched on our own are still likely to be used
+    if (!mEntries.contains(appId) || !mEntries.value(appId).hinted)
+        return false;
+
+    discard(appId);
+
+    return true;
+}
+
+void Prelauncher::applicationStarted(const QString &appId)
+{
+    mPredictor.recordStart(appId);
+
+    if (mPredictor.dirty() && !mSaveTimer.isActive())
+        mSaveTimer.start(PRELAUNCH_SAVE_DELAY);
+
+    if (mMaxApplications > 0)
+        mIdleTimer.start(PRELAUNCH_IDLE_DELAY);
+}
+
+void Prelauncher::applicationAdopted(const QString &appId)
+{
+    if (!mEntries.contains(appId))
+        return;
+
+    Entry entry = mEntries.take(appId);
+    qint64 age = (LaunchTimeline::now() / 1000) - entry.prelaunchedAt;
+
+    mHits++;
+    if (entry.hinted)
+        mHintHits++;
+
+    qDebug() << __PRETTY_FUNCTION__ << "Prelaunched application" << appId
+             << "was adopted after" << age << "ms";
+}
+
+void Prelauncher::applicationClosed(const QString &appId)
+{
+    mEntries.remove(appId);
+}
+
+void Prelauncher::discard(const QString &appId)
+{
+    if (!mEntries.contains(appId))
+        return;
+
+    qDebug() << __PRETTY_FUNCTION__ << "Discarding prelaunched application" << appId;
+
+    mEntries.remove(appId);
+    mDiscarded++;
+
+    mWebAppManager->killApp(appId);
+}
+
+void Prelauncher::discardAll()
+{
+    Q_FOREACH(QString appId, mEntries.keys())
+        discard(appId);
+}
+
+int Prelauncher::active() const
+{
+    return mEntries.count();
+}
+
+int Prelauncher::prelaunched() const
+{
+    return mPrelaunched;
+}
+
+int Prelauncher::hits() const
+{
+    return mHits;
+}
+
+int Prelauncher::discarded() const
+{
+    return mDiscarded;
+}
+
+int Prelauncher::hints() const
+{
+    return mHints;
+}
+
+int Prelauncher::hintHits() const
+{
+    return mHintHits;
+}
+
+QStringList Prelauncher::predictions() const
+{
+    return mPredictor.predict(mPredictor.lastAppId(), mMaxApplications);
+}
+
+qint64 Prelauncher::availableMemory()
+{
+    QFile file("/proc/meminfo");
+    if (!file.open(QIODevice::ReadOnly))
+        return -1;
+
+    // Older kernels don't provide MemAvailable so we fall back to an estimate
+    // from the free and cached memory
+    qint64 available = -1;
+    qint64 freeAndCached = 0;
+
+    Q_FOREACH(QByteArray line, file.readAll().split('\n')) {
+        QList<QByteArray> fields = line.simplified().split(' ');
+        if (fields.count() < 2)
+            continue;
+
+        qint64 value = fields[1].toLongLong() / 1024;
+
+        if (fields[0] == "MemAvailable:")
+            available = value;
+        else if (fields[0] == "MemFree:" || fields[0] == "Cached:")
+            freeAndCached += value;
+    }
+
+    return available >= 0 ? available : freeAndCached;
+}
+
+bool Prelauncher::prelaunch(const QString &appId, bool hinted)
+{
+    WebApplication *app = mWebAppManager->prelaunchApp(appId, mNextProcessId, hinted);
+    if (!app)
+        return false;
+
+    // Prelaunched applications get placeholder process ids which never clash
+    // with the ones handed out by the application manager
+    mNextProcessId--;
+
+    Entry entry;
+    entry.prelaunchedAt = LaunchTimeline::now() / 1000;
+    entry.expiresAt = entry.prelaunchedAt + (hinted ? PRELAUNCH_HINT_EXPIRY : PRELAUNCH_EXPIRY);
+    entry.hinted = hinted;
+
+    mEntries.insert(appId, entry);
+    mPrelaunched++;
+
+    scheduleExpiry();
+
+    qDebug() << __PRETTY_FUNCTION__ << "Prelaunched application" << appId << (hinted ? "on hint" : "");
+
+    return true;
+}
+
+QString Prelauncher::oldestEntry(bool hinted) const
+{
+    QString oldest;
+    qint64 oldestPrelaunchedAt = 0;
+
+    for (QMap<QString, Entry>::const_iterator it = mEntries.constBegin(); it != mEntries.constEnd(); ++it) {
+        if (it.value().hinted != hinted)
+            continue;
+
+        if (oldest.isEmpty() || it.value().prelaunchedAt < oldestPrelaunchedAt) {
+            oldest = it.key();
+            oldestPrelaunchedAt = it.value().prelaunchedAt;
+        }
+    }
+
+    return oldest;
+}
+
+void Prelauncher::scheduleExpiry()
+{
+    if (mEntries.isEmpty()) {
+        mExpireTimer.stop();
+        return;
+    }
+
+    qint64 nextExpiry = -1;
+    Q_FOREACH(Entry entry, mEntries.values()) {
+        if (nextExpiry < 0 || entry.expiresAt < nextExpiry)
+            nextExpiry = entry.expiresAt;
+    }
+
+    mExpireTimer.start(qMax((qint64) 0, nextExpiry - LaunchTimeline::now() / 1000));
+}
+
+void Prelauncher::onIdleTimeout()
+{
+    if (mMaxApplications == 0)
+        return;
+
+    // Launches which are still queued have precedence
+    if (mWebAppManager->launchScheduler()->depth() > 0) {
+        mIdleTimer.start(PRELAUNCH_IDLE_DELAY);
+        return;
+    }
+
+    qint64 available = availableMemory();
+    if (available >= 0 && available < mMemoryBudget) {
+        qDebug() << __PRETTY_FUNCTION__ << "Only" << available << "MB of memory available, not prelaunching";
+        discardAll();
+        return;
+    }
+
+    QStringList candidates = predictions();
+
+    // Applications which are not likely to be next anymore only waste memory
+    Q_FOREACH(QString appId, mEntries.keys()) {
+        if (!mEntries.value(appId).hinted && !candidates.contains(appId))
+            discard(appId);
+    }
+
+    // Prelaunch one application at a time and come back for the next one
+    Q_FOREACH(QString appId, candidates) {
+        if (mEntries.contains(appId) || mWebAppManager->isAppRunning(appId))
+            continue;
+
+        if (prelaunch(appId, false)) {
+            mIdleTimer.start(PRELAUNCH_NEXT_DELAY);
+            break;
+        }
+    }
+}
+
+void Prelauncher::onExpireTimeout()
+{
+    qint64 now = LaunchTimeline::now() / 1000;
+
+    Q_FOREACH(QString appId, mEntries.keys()) {
+        if (mEntries.value(appId).expiresAt <= now)
+            discard(appId);
+    }
+
+    scheduleExpiry();
+}
+
+void Prelauncher::onSaveTimeout()
+{
+    mPredictor.save();
+}
+
+} // namespace luna
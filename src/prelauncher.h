@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef PRELAUNCHER_H
+#define PRELAUNCHER_H
+
+#include <QObject>
+#include <QMap>
+#include <QStringList>
+#include <QTimer>
+
+#include "launchpredictor.h"
+
+namespace luna
+{
+
+class WebAppManager;
+
+/*
+ * Learns which applications are usually started after each other and, once
+ * the system is idle, launches the most likely next ones hidden in the
+ * background. A prelaunched application doesn't have a process id or an
+ * activity and isn't reported to anyone until a real launch adopts it. It is
+ * thrown away again when it wasn't used for a while, isn't predicted anymore
+ * or the available memory drops below the budget.
+ *
+ * Launchers can also hint at a launch which is about to happen, for example
+ * when an icon is touched. Such an application is prelaunched right away and
+ * thrown away after a short time if the launch doesn't follow. Hinted
+ * applications count against the same limit and replace the oldest hinted
+ * one, or a predicted one if none was hinted.
+ */
+class Prelauncher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Prelauncher(WebAppManager *webAppManager, QObject *parent = 0);
+    ~Prelauncher();
+
+    void setMaxApplications(int count);
+    int maxApplications() const;
+
+    void setMemoryBudget(int megabytes);
+    int memoryBudget() const;
+
+    bool hint(const QString &appId);
+    bool cancel(const QString &appId);
+
+    void applicationStarted(const QString &appId);
+    void applicationAdopted(const QString &appId);
+    void applicationClosed(const QString &appId);
+
+    void discard(const QString &appId);
+    void discardAll();
+
+    int active() const;
+    int prelaunched() const;
+    int hits() const;
+    int discarded() const;
+    int hints() const;
+    int hintHits() const;
+    QStringList predictions() const;
+
+    static qint64 availableMemory();
+
+private Q_SLOTS:
+    void onIdleTimeout();
+    void onExpireTimeout();
+    void onSaveTimeout();
+
+private:
+    WebAppManager *mWebAppManager;
+    struct Entry
+    {
+        qint64 prelaunchedAt;
+        qint64 expiresAt;
+        bool hinted;
+    };
+
+    LaunchPredictor mPredictor;
+    QMap<QString, Entry> mEntries;
+    QTimer mIdleTimer;
+    QTimer mExpireTimer;
+    QTimer mSaveTimer;
+    int mMaxApplications;
+    int mMemoryBudget;
+    int64_t mNextProcessId;
+    int mPrelaunched;
+    int mHits;
+    int mDiscarded;
+    int mHints;
+    int mHintHits;
+
+    bool prelaunch(const QString &appId, bool hinted);
+    QString oldestEntry(bool hinted) const;
+    void scheduleExpiry();
+};
+
+} // namespace luna
+
+#endif // PRELAUNCHER_H
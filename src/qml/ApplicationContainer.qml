@@ -40,7 +40,7 @@ Flickable {
        onStateChanged: {
            // When we are online again reload the web view in order to start the application
            // which is still visible to the user
-           if (webApp.internetConnectivityRequired &&
+           if (webApp && webApp.internetConnectivityRequired &&
                oldState !== networkManager.state &&
                networkManager.state === "online")
                webView.reload();
@@ -51,7 +51,7 @@ Flickable {
         id: offlinePanel
 
         color: "white"
-        visible: webApp.internetConnectivityRequired && networkManager.state !== "online"
+        visible: webApp !== null && webApp.internetConnectivityRequired && networkManager.state !== "online"
         anchors.fill: parent
 
         z: 10
@@ -65,13 +65,84 @@ Flickable {
         }
     }
 
-    Component.onCompleted: {
-        if (webApp.isLauncher())
+    // Called once the container is bound to an application. This happens right
+    // away when the container is created for an application or later on when a
+    // spare container gets adopted by a launching application.
+    function bindApplication() {
+        if (webViewLoader.item !== null) {
+            setupWebView(webViewLoader.item);
+            return;
+        }
+
+        // Applications loaded on first show only get their web view once the
+        // window becomes visible
+        if (webApp.loadOnFirstShow && !webAppWindow.visible)
             return;
 
         webViewLoader.sourceComponent = webViewComponent;
     }
 
+    function setupWebView(webView) {
+        var experimental = webView.experimental;
+
+        // Let the native side configure us as needed
+        webAppWindow.configureWebView(webView);
+
+        // Only when we have a system application we enable the webOS API and the
+        // PalmServiceBridge to avoid remote applications accessing unwanted system
+        // internals
+        if (webAppWindow.trustScope === "system") {
+            if (experimental.hasOwnProperty('userScriptsInjectAtStart') &&
+                experimental.hasOwnProperty('userScriptsForAllFrames')) {
+                experimental.userScripts = webAppWindow.userScripts;
+                experimental.userScriptsInjectAtStart = true;
+                experimental.userScriptsForAllFrames = true;
+            }
+
+            if (experimental.preferences.hasOwnProperty("palmServiceBridgeEnabled"))
+                experimental.preferences.palmServiceBridgeEnabled = true;
+
+            if (experimental.preferences.hasOwnProperty("privileged"))
+                experimental.preferences.privileged = webApp.privileged;
+
+            if (experimental.preferences.hasOwnProperty("identifier"))
+                experimental.preferences.identifier = webApp.identifier;
+
+            if (webApp.allowCrossDomainAccess) {
+                if (experimental.preferences.hasOwnProperty("appRuntime"))
+                    experimental.preferences.appRuntime = false;
+
+                experimental.preferences.universalAccessFromFileURLsAllowed = true;
+                experimental.preferences.fileAccessFromFileURLsAllowed = true;
+            }
+            else {
+                if (experimental.preferences.hasOwnProperty("appRuntime"))
+                    experimental.preferences.appRuntime = true;
+
+                experimental.preferences.universalAccessFromFileURLsAllowed = false;
+                experimental.preferences.fileAccessFromFileURLsAllowed = false;
+            }
+        }
+
+        if (experimental.preferences.hasOwnProperty("logsPageMessagesToSystemConsole"))
+            experimental.preferences.logsPageMessagesToSystemConsole = true;
+
+        if (experimental.preferences.hasOwnProperty("suppressIncrementalRendering"))
+            experimental.preferences.suppressIncrementalRendering = true;
+    }
+
+    Component.onCompleted: {
+        // A spare container isn't bound to any application yet. We create the
+        // web view right away to get its web process started and configure it
+        // once an application adopts us.
+        if (!webApp) {
+            webViewLoader.sourceComponent = webViewComponent;
+            return;
+        }
+
+        bindApplication();
+    }
+
     Loader {
         id: webViewLoader
         anchors.left: parent.left
@@ -83,7 +154,7 @@ Flickable {
     Connections {
         target: webAppWindow
         onVisibleChanged: {
-            if (!webApp.isLauncher())
+            if (!webApp || !webApp.loadOnFirstShow)
                 return;
 
             if (!webAppWindow.visible)
@@ -96,6 +167,19 @@ Flickable {
         }
     }
 
+    Connections {
+        target: webApp
+        onProcessIdChanged: {
+            // A prelaunched application gets its real identity once it's adopted
+            var webView = webViewLoader.item;
+            if (webView === null || webAppWindow.trustScope !== "system")
+                return;
+
+            if (webView.experimental.preferences.hasOwnProperty("identifier"))
+                webView.experimental.preferences.identifier = webApp.identifier;
+        }
+    }
+
     Component {
         id: webViewComponent
 
@@ -116,7 +200,7 @@ Flickable {
                                                             "window.Mojo.positiveSpaceChanged(" + positiveSpace.width +
                                                             "," + positiveSpace.height + ");}");
 
-                    if (Qt.inputMethod.visible && webAppWindow.focus)
+                    if (Qt.inputMethod.visible && webAppWindow && webAppWindow.focus)
                         keyboardContainer.height = Qt.inputMethod.keyboardRectangle.height;
                     else
                         keyboardContainer.height = 0;
@@ -143,7 +227,8 @@ Flickable {
             experimental.preferences.serifFontFamily: "Times New Roman"
             experimental.preferences.cursiveFontFamily: "Prelude"
 
-            experimental.transparentBackground: (webAppWindow.windowType === "dashboard" ||
+            experimental.transparentBackground: webAppWindow !== null &&
+                                                (webAppWindow.windowType === "dashboard" ||
                                                  webAppWindow.windowType === "popupalert")
 
             experimental.databaseQuotaDialog: Item {
@@ -166,7 +251,7 @@ Flickable {
 
             function getUserAgentForApp(url) {
                 /* if the app wants a specific user agent assign it instead of the default one */
-                if (webApp.userAgent.length > 0)
+                if (webApp && webApp.userAgent.length > 0)
                     return webApp.userAgent;
 
                 return userAgent.defaultUA;
@@ -257,50 +342,8 @@ Flickable {
             }
 
             Component.onCompleted: {
-                // Let the native side configure us as needed
-                webAppWindow.configureWebView(webView);
-
-                // Only when we have a system application we enable the webOS API and the
-                // PalmServiceBridge to avoid remote applications accessing unwanted system
-                // internals
-                if (webAppWindow.trustScope === "system") {
-                    if (experimental.hasOwnProperty('userScriptsInjectAtStart') &&
-                        experimental.hasOwnProperty('userScriptsForAllFrames')) {
-                        experimental.userScripts = webAppWindow.userScripts;
-                        experimental.userScriptsInjectAtStart = true;
-                        experimental.userScriptsForAllFrames = true;
-                    }
-
-                    if (experimental.preferences.hasOwnProperty("palmServiceBridgeEnabled"))
-                        experimental.preferences.palmServiceBridgeEnabled = true;
-
-                    if (experimental.preferences.hasOwnProperty("privileged"))
-                        experimental.preferences.privileged = webApp.privileged;
-
-                    if (experimental.preferences.hasOwnProperty("identifier"))
-                        experimental.preferences.identifier = webApp.identifier;
-
-                    if (webApp.allowCrossDomainAccess) {
-                        if (experimental.preferences.hasOwnProperty("appRuntime"))
-                            experimental.preferences.appRuntime = false;
-
-                        experimental.preferences.universalAccessFromFileURLsAllowed = true;
-                        experimental.preferences.fileAccessFromFileURLsAllowed = true;
-                    }
-                    else {
-                        if (experimental.preferences.hasOwnProperty("appRuntime"))
-                            experimental.preferences.appRuntime = true;
-
-                        experimental.preferences.universalAccessFromFileURLsAllowed = false;
-                        experimental.preferences.fileAccessFromFileURLsAllowed = false;
-                    }
-                }
-
-                if (experimental.preferences.hasOwnProperty("logsPageMessagesToSystemConsole"))
-                    experimental.preferences.logsPageMessagesToSystemConsole = true;
-
-                if (experimental.preferences.hasOwnProperty("suppressIncrementalRendering"))
-                    experimental.preferences.suppressIncrementalRendering = true;
+                if (webApp)
+                    webViewContainer.setupWebView(webView);
             }
 
             experimental.onMessageReceived: {
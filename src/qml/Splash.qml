@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+import QtQuick 2.0
+
+// Shown on top of the application container from the very first frame of a
+// window until the web view has something to show.
+Item {
+    id: splash
+
+    property url icon
+
+    signal dismissed()
+
+    anchors.fill: parent
+    z: 100
+
+    function dismiss() {
+        fadeOut.start();
+    }
+
+    Image {
+        anchors.fill: parent
+        source: "images/loading-bg.png"
+        fillMode: Image.Tile
+    }
+
+    Image {
+        anchors.centerIn: parent
+        source: "images/loading-glow.png"
+    }
+
+    Image {
+        anchors.centerIn: parent
+        width: 64
+        height: 64
+        source: splash.icon
+        fillMode: Image.PreserveAspectFit
+        smooth: true
+    }
+
+    SequentialAnimation {
+        id: fadeOut
+
+        NumberAnimation {
+            target: splash
+            property: "opacity"
+            to: 0
+            duration: 250
+        }
+
+        ScriptAction {
+            script: splash.dismissed()
+        }
+    }
+}
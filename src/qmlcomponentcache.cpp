@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDebug>
+#include <QQmlComponent>
+#include <QQmlEngine>
+
+#include "qmlcomponentcache.h"
+
+namespace luna
+{
+
+int QmlComponentCache::sHits = 0;
+int QmlComponentCache::sMisses = 0;
+
+QQmlComponent* QmlComponentCache::component(QQmlEngine *engine, const QUrl &url)
+{
+    if (!engine)
+        return 0;
+
+    QString key = url.toString();
+
+    QQmlComponent *component = engine->findChild<QQmlComponent*>(key, Qt::FindDirectChildrenOnly);
+    if (component) {
+        sHits++;
+        return component;
+    }
+
+    sMisses++;
+
+    component = new QQmlComponent(engine, url, engine);
+    component->setObjectName(key);
+
+    if (component->isError())
+        qWarning() << "Failed to compile" << url << ":" << component->errors();
+
+    return component;
+}
+
+int QmlComponentCache::hits()
+{
+    return sHits;
+}
+
+int QmlComponentCache::misses()
+{
+    return sMisses;
+}
+
+} // namespace luna
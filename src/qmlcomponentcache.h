@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef QMLCOMPONENTCACHE_H
+#define QMLCOMPONENTCACHE_H
+
+#include <QUrl>
+
+class QQmlComponent;
+class QQmlEngine;
+
+namespace luna
+{
+
+/*
+ * Keeps compiled components per engine so instantiating one of our QML files
+ * a second time doesn't go through the type loader again. The components are
+ * children of the engine they were compiled for and go away together with it.
+ */
+class QmlComponentCache
+{
+public:
+    static QQmlComponent* component(QQmlEngine *engine, const QUrl &url);
+
+    static int hits();
+    static int misses();
+
+private:
+    static int sHits;
+    static int sMisses;
+};
+
+} // namespace luna
+
+#endif // QMLCOMPONENTCACHE_H
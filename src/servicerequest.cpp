@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "servicerequest.h"
+#include "servicestats.h"
+#include "launchtimeline.h"
+
+namespace luna
+{
+
+ServiceRequest::~ServiceRequest()
+{
+}
+
+ServiceRequest* ServiceRequest::defer()
+{
+    return 0;
+}
+
+bool ServiceRequest::isFailure(const char *payload)
+{
+    // All our responses put the return value first
+    return qstrncmp(payload, "{\"returnValue\":false", 20) == 0;
+}
+
+LunaServiceRequest::LunaServiceRequest(LSMessage *message, ServiceStats *stats) :
+    mMessage(message),
+    mStats(stats),
+    mReceivedAt(LaunchTimeline::now())
+{
+}
+
+const char* LunaServiceRequest::getPayload() const
+{
+    return mMessage.getPayload();
+}
+
+void LunaServiceRequest::respond(const char *payload)
+{
+    mMessage.respond(payload);
+
+    if (mStats)
+        mStats->record(method(), LaunchTimeline::now() - mReceivedAt, qstrlen(getPayload()),
+                       qstrlen(payload), isFailure(payload));
+}
+
+LS::Message& LunaServiceRequest::message()
+{
+    return mMessage;
+}
+
+const char* LunaServiceRequest::method() const
+{
+    return mMessage.getMethod();
+}
+
+ServiceRequest* LunaServiceRequest::defer()
+{
+    // The copy keeps its own reference on the message
+    return new LunaServiceRequest(*this);
+}
+
+ForwardedServiceRequest::ForwardedServiceRequest(const Responder &responder) :
+    mResponder(responder)
+{
+}
+
+const char* ForwardedServiceRequest::getPayload() const
+{
+    // Everything the handler needs was decoded before the request was
+    // forwarded
+    return "{}";
+}
+
+void ForwardedServiceRequest::respond(const char *payload)
+{
+    mResponder(QByteArray(payload));
+}
+
+ServiceRequest* ForwardedServiceRequest::defer()
+{
+    return new ForwardedServiceRequest(*this);
+}
+
+LocalServiceRequest::LocalServiceRequest(const QByteArray &payload, const Responder &responder) :
+    mPayload(payload),
+    mResponder(responder)
+{
+}
+
+const char* LocalServiceRequest::getPayload() const
+{
+    return mPayload.constData();
+}
+
+void LocalServiceRequest::respond(const char *payload)
+{
+    mResponder(QByteArray(payload));
+}
+
+ServiceRequest* LocalServiceRequest::defer()
+{
+    return new LocalServiceRequest(*this);
+}
+
+} // namespace luna
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef SERVICEREQUEST_H
+#define SERVICEREQUEST_H
+
+#include <QByteArray>
+
+#include <functional>
+
+#include <luna-service2/lunaservice.hpp>
+
+namespace luna
+{
+
+class ServiceStats;
+
+/*
+ * A single call of one of our service methods. The handlers of the service
+ * only see this interface so they can be driven by a message received from the
+ * bus as well as by a request created in the same process without any bus.
+ */
+class ServiceRequest
+{
+public:
+    virtual ~ServiceRequest();
+
+    virtual const char* getPayload() const = 0;
+    virtual void respond(const char *payload) = 0;
+
+    /*
+     * Returns a copy of the request which can still be responded to after
+     * the handler returned or 0 if the request has to be responded to right
+     * away. The caller owns the copy.
+     */
+    virtual ServiceRequest* defer();
+
+    static bool isFailure(const char *payload);
+};
+
+/*
+ * Request received through luna-service2. Once it's responded to, the call is
+ * recorded in the service statistics with the time since it was received, so
+ * it has to be responded to from the thread owning the statistics.
+ */
+class LunaServiceRequest : public ServiceRequest
+{
+public:
+    LunaServiceRequest(LSMessage *message, ServiceStats *stats);
+
+    const char* getPayload() const;
+    void respond(const char *payload);
+    ServiceRequest* defer();
+
+    LS::Message& message();
+    const char* method() const;
+
+private:
+    LS::Message mMessage;
+    ServiceStats *mStats;
+    qint64 mReceivedAt;
+};
+
+/*
+ * Request received on another thread and handed over to be handled on this
+ * one. Its payload was already decoded on the thread it came from so it only
+ * carries the responder, which takes care of sending the response from there.
+ */
+class ForwardedServiceRequest : public ServiceRequest
+{
+public:
+    typedef std::function<void (const QByteArray &response)> Responder;
+
+    explicit ForwardedServiceRequest(const Responder &responder);
+
+    const char* getPayload() const;
+    void respond(const char *payload);
+    ServiceRequest* defer();
+
+private:
+    Responder mResponder;
+};
+
+/*
+ * Request created in process, see WebAppManagerService::call(). The response
+ * is passed to the responder on the thread responding to the request.
+ */
+class LocalServiceRequest : public ServiceRequest
+{
+public:
+    typedef std::function<void (const QByteArray &response)> Responder;
+
+    LocalServiceRequest(const QByteArray &payload, const Responder &responder);
+
+    const char* getPayload() const;
+    void respond(const char *payload);
+    ServiceRequest* defer();
+
+private:
+    QByteArray mPayload;
+    Responder mResponder;
+};
+
+} // namespace luna
+
+#endif // SERVICEREQUEST_H
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <string.h>
+
+#include "servicestats.h"
+#include "launchtimeline.h"
+#include "jsonwriter.h"
+
+namespace luna
+{
+
+ServiceStats::ServiceStats() :
+    mResetAt(LaunchTimeline::now())
+{
+}
+
+void ServiceStats::record(const char *method, qint64 latency, int requestSize, int responseSize,
+                          bool failed)
+{
+    if (!method)
+        return;
+
+    // Only look the method up with a copy of its name the first time it's
+    // called, afterwards the raw data is enough for the lookup
+    QHash<QByteArray, MethodStats>::iterator it = mMethods.find(QByteArray::fromRawData(method, qstrlen(method)));
+    if (it == mMethods.end()) {
+        MethodStats stats;
+        memset(&stats, 0, sizeof(stats));
+        it = mMethods.insert(QByteArray(method), stats);
+    }
+
+    MethodStats &stats = it.value();
+    stats.calls++;
+    if (failed)
+        stats.errors++;
+    stats.requestBytes += requestSize;
+    stats.responseBytes += responseSize;
+    stats.totalLatency += latency;
+    stats.maxLatency = qMax(stats.maxLatency, latency);
+    stats.latencyHistogram[latencyBucket(latency)]++;
+}
+
+void ServiceStats::reset()
+{
+    mMethods.clear();
+    mResetAt = LaunchTimeline::now();
+}
+
+int ServiceStats::latencyBucket(qint64 latency)
+{
+    int bucket = 0;
+
+    while (latency > 1 && bucket < SERVICE_STATS_LATENCY_BUCKETS - 1) {
+        latency >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+void ServiceStats::write(JsonWriter &writer) const
+{
+    writer.insert("periodMs", (LaunchTimeline::now() - mResetAt) / 1000);
+
+    writer.beginObject("methods");
+
+    QHash<QByteArray, MethodStats>::const_iterator it;
+    for (it = mMethods.constBegin(); it != mMethods.constEnd(); ++it) {
+        const MethodStats &stats = it.value();
+
+        writer.beginObject(it.key().constData());
+        writer.insert("calls", (qint64) stats.calls);
+        writer.insert("errors", (qint64) stats.errors);
+        writer.insert("requestBytes", (qint64) stats.requestBytes);
+        writer.insert("responseBytes", (qint64) stats.responseBytes);
+        writer.insert("averageLatencyUs", (qint64) (stats.totalLatency / stats.calls));
+        writer.insert("maxLatencyUs", stats.maxLatency);
+
+        // Trailing empty buckets are left out to keep the response short
+        int used = SERVICE_STATS_LATENCY_BUCKETS;
+        while (used > 0 && stats.latencyHistogram[used - 1] == 0)
+            used--;
+
+        writer.beginArray("latencyHistogram");
+        for (int n = 0; n < used; n++)
+            writer.append((qint64) stats.latencyHistogram[n]);
+        writer.endArray();
+
+        writer.endObject();
+    }
+
+    writer.endObject();
+}
+
+} // namespace luna
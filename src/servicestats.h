@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef SERVICESTATS_H
+#define SERVICESTATS_H
+
+#include <QByteArray>
+#include <QHash>
+
+/* Latency histograms have one bucket per power of two microseconds; the last
+ * one collects everything taking longer than about a second. */
+#define SERVICE_STATS_LATENCY_BUCKETS   21
+
+namespace luna
+{
+
+class JsonWriter;
+
+/*
+ * Counts the calls of every service method together with their errors, the
+ * size of requests and responses and a histogram of how long the handler
+ * took. Recording a call doesn't allocate unless it's the first call of a
+ * method so it can stay enabled all the time.
+ */
+class ServiceStats
+{
+public:
+    ServiceStats();
+
+    void record(const char *method, qint64 latency, int requestSize, int responseSize, bool failed);
+    void reset();
+
+    void write(JsonWriter &writer) const;
+
+private:
+    struct MethodStats
+    {
+        quint64 calls;
+        quint64 errors;
+        quint64 requestBytes;
+        quint64 responseBytes;
+        qint64 totalLatency;
+        qint64 maxLatency;
+        quint64 latencyHistogram[SERVICE_STATS_LATENCY_BUCKETS];
+    };
+
+    QHash<QByteArray, MethodStats> mMethods;
+    qint64 mResetAt;
+
+    static int latencyBucket(qint64 latency);
+};
+
+} // namespace luna
+
+#endif // SERVICESTATS_H
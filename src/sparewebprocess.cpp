@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDebug>
+#include <QQuickView>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QtWebKit/private/qquickwebview_p.h>
+
+#include "sparewebprocess.h"
+#include "windowpool.h"
+
+/* Time to wait after the spare was adopted before we start the next one. The
+ * new web process competes with the one of the launching application so we
+ * don't want to spawn it right away. */
+#define SPARE_WEB_PROCESS_SPAWN_DELAY       2000
+
+namespace luna
+{
+
+SpareWebProcess::SpareWebProcess(WindowPool *pool, QObject *parent) :
+    QObject(parent),
+    mPool(pool),
+    mSpare(0),
+    mSpawnTimer(this),
+    mEnabled(true),
+    mHits(0),
+    mMisses(0),
+    mTotalAgeOnHit(0)
+{
+    connect(&mSpawnTimer, SIGNAL(timeout()), this, SLOT(onSpawnTimeout()));
+    mSpawnTimer.setSingleShot(true);
+
+    scheduleSpawn();
+}
+
+SpareWebProcess::~SpareWebProcess()
+{
+    if (mSpare)
+        delete mSpare;
+}
+
+void SpareWebProcess::setEnabled(bool enabled)
+{
+    mEnabled = enabled;
+
+    if (!mEnabled) {
+        mSpawnTimer.stop();
+
+        if (mSpare) {
+            delete mSpare;
+            mSpare = 0;
+        }
+
+        return;
+    }
+
+    scheduleSpawn();
+}
+
+bool SpareWebProcess::enabled() const
+{
+    return mEnabled;
+}
+
+QQuickView* SpareWebProcess::take()
+{
+    if (!mEnabled)
+        return 0;
+
+    if (!mSpare) {
+        mMisses++;
+        qDebug() << __PRETTY_FUNCTION__ << "No spare web process available (hits" << mHits
+                 << "misses" << mMisses << ")";
+        scheduleSpawn();
+        return 0;
+    }
+
+    mHits++;
+    mTotalAgeOnHit += mSpareAge.elapsed();
+
+    qDebug() << __PRETTY_FUNCTION__ << "Handing out spare web process with age"
+             << mSpareAge.elapsed() << "ms (hits" << mHits << "misses" << mMisses << ")";
+
+    QQuickView *spare = mSpare;
+    mSpare = 0;
+
+    scheduleSpawn();
+
+    return spare;
+}
+
+bool SpareWebProcess::available() const
+{
+    return mSpare != 0;
+}
+
+int SpareWebProcess::hits() const
+{
+    return mHits;
+}
+
+int SpareWebProcess::misses() const
+{
+    return mMisses;
+}
+
+qint64 SpareWebProcess::age() const
+{
+    if (!mSpare)
+        return -1;
+
+    return mSpareAge.elapsed();
+}
+
+qint64 SpareWebProcess::averageAgeOnHit() const
+{
+    if (mHits == 0)
+        return 0;
+
+    return mTotalAgeOnHit / mHits;
+}
+
+void SpareWebProcess::scheduleSpawn()
+{
+    if (!mEnabled || mSpare || mSpawnTimer.isActive())
+        return;
+
+    mSpawnTimer.start(SPARE_WEB_PROCESS_SPAWN_DELAY);
+}
+
+void SpareWebProcess::onSpawnTimeout()
+{
+    if (!mEnabled || mSpare)
+        return;
+
+    qDebug() << __PRETTY_FUNCTION__ << "Spawning spare web process";
+
+    QQuickView *window = mPool->take();
+    if (!window)
+        window = mPool->createWindow();
+
+    // Without any application bound the container will only create its web view
+    // which already launches the web process for it.
+    QQmlContext *context = mPool->contextForWindow(window);
+    context->setContextProperty("webApp", QVariant::fromValue<QObject*>(0));
+    context->setContextProperty("webAppWindow", QVariant::fromValue<QObject*>(0));
+
+    // The spare is only used for applications without a flickable viewport.
+    // Restore the previous mode afterwards as a container might be incubated
+    // at the same time which relies on it.
+    bool flickableViewportEnabled = QQuickWebViewExperimental::flickableViewportEnabled();
+    QQuickWebViewExperimental::setFlickableViewportEnabled(false);
+
+    QObject *rootObject = mPool->loadContainer(window);
+
+    QQuickWebViewExperimental::setFlickableViewportEnabled(flickableViewportEnabled);
+
+    if (!rootObject) {
+        qWarning() << "Failed to create spare application container";
+        delete window;
+        return;
+    }
+
+    mSpare = window;
+    mSpareAge.start();
+}
+
+} // namespace luna
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef SPAREWEBPROCESS_H
+#define SPAREWEBPROCESS_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+
+class QQuickView;
+
+namespace luna
+{
+
+class WindowPool;
+
+/*
+ * Keeps one window around which has the application container already
+ * instantiated but not bound to any application. The container creates its web
+ * view right away which spawns the web process in the background. The next
+ * launch adopts the whole window and only has to bind the application to it
+ * before the first navigation can start.
+ */
+class SpareWebProcess : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SpareWebProcess(WindowPool *pool, QObject *parent = 0);
+    ~SpareWebProcess();
+
+    void setEnabled(bool enabled);
+    bool enabled() const;
+
+    QQuickView* take();
+
+    bool available() const;
+    int hits() const;
+    int misses() const;
+    qint64 age() const;
+    qint64 averageAgeOnHit() const;
+
+private Q_SLOTS:
+    void onSpawnTimeout();
+
+private:
+    WindowPool *mPool;
+    QQuickView *mSpare;
+    QElapsedTimer mSpareAge;
+    QTimer mSpawnTimer;
+    bool mEnabled;
+    int mHits;
+    int mMisses;
+    qint64 mTotalAgeOnHit;
+
+    void scheduleSpawn();
+};
+
+} // namespace luna
+
+#endif // SPAREWEBPROCESS_H
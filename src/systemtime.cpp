@@ -16,14 +16,13 @@
  */
 
 #include <QDebug>
-#include <QJsonDocument>
-#include <QJsonObject>
 
 #include <time.h>
 
 #include <luna-service2++/message.hpp>
 
 #include "systemtime.h"
+#include "jsonreader.h"
 
 namespace luna
 {
@@ -75,15 +74,13 @@ void SystemTime::updateFromService(LSMessage *message)
 {
     LS::Message msg{message};
 
-    QJsonDocument document = QJsonDocument::fromJson(QByteArray(msg.getPayload()));
+    JsonReader root(msg.getPayload());
 
-    if (!document.isObject())
+    if (!root.isValid())
         return;
 
-    QJsonObject root = document.object();
-
     if (root.contains("timezone")) {
-        QString timezone = root.value("timezone").toString("");
+        QString timezone = root.string("timezone", "");
         if (timezone != mTimezone) {
             mTimezone = timezone;
 
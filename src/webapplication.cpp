@@ -32,6 +32,7 @@
 #include "applicationdescription.h"
 #include "webapplication.h"
 #include "webapplicationwindow.h"
+#include "launchrequest.h"
 
 #include <Settings.h>
 
@@ -111,18 +112,37 @@ private:
 };
 
 WebApplication::WebApplication(WebAppManager *launcher, const QUrl& url, const QString& windowType,
-                               const ApplicationDescription& desc, const QString& parameters,
-                               const int64_t processId, QObject *parent) :
+                               const ApplicationDescription& desc, const QJsonValue& parameters,
+                               const int64_t processId, const LaunchTimeline &timeline,
+                               Prelaunch prelaunch, QObject *parent) :
+    WebApplication(launcher, desc, parameters, processId, timeline, prelaunch, parent)
+{
+    // A prelaunched application isn't known to anyone else yet so it only
+    // gets its activity once it's adopted by a real launch
+    if (mPrelaunch == PrelaunchNone)
+        mActivity = new Activity(mIdentifier, desc.id(), processId);
+
+    mMainWindow = new WebApplicationWindow(this, url, windowType,
+            QSize(Settings::LunaSettings()->displayWidth, Settings::LunaSettings()->displayHeight),
+            mDescription.headless());
+}
+
+WebApplication::WebApplication(WebAppManager *launcher, const ApplicationDescription& desc,
+                               const QJsonValue& parameters, const int64_t processId,
+                               const LaunchTimeline &timeline, Prelaunch prelaunch, QObject *parent) :
     QObject(parent),
     mLauncher(launcher),
     mDescription(desc),
     mProcessId(processId),
     mIdentifier(QString("%1 %2").arg(mDescription.id()).arg(mProcessId)),
-    mParameters(parameters),
+    mParameters(LaunchRequest::parametersToString(parameters)),
     mMainWindow(0),
     mLaunchedAtBoot(false),
+    mLoadOnFirstShow(false),
+    mPrelaunch(prelaunch),
     mPrivileged(false),
-    mActivity(mIdentifier, desc.id(), processId)
+    mActivity(0),
+    mLaunchTimeline(timeline)
 {
     qDebug() << __PRETTY_FUNCTION__ << this;
 
@@ -132,11 +152,12 @@ WebApplication::WebApplication(WebAppManager *launcher, const QUrl& url, const Q
         mDescription.id().startsWith("org.webosinternals"))
         mPrivileged = true;
 
-    mMainWindow = new WebApplicationWindow(this, url, windowType,
-            QSize(Settings::LunaSettings()->displayWidth, Settings::LunaSettings()->displayHeight),
-            mDescription.headless());
-
-    processParameters();
+    // Parameters can change how the window is set up so they have to be
+    // known before it's created
+    if (parameters.isObject())
+        processParameters(parameters.toObject());
+    else if (parameters.isString())
+        processParameters(QJsonDocument::fromJson(mParameters.toUtf8()).object());
 }
 
 WebApplication::~WebApplication()
@@ -150,25 +171,69 @@ WebApplication::~WebApplication()
 
     if (mMainWindow)
         delete mMainWindow;
+
+    delete mActivity;
 }
 
-void WebApplication::processParameters()
+void WebApplication::processParameters(const QJsonObject &parameters)
 {
-    QJsonDocument document = QJsonDocument::fromJson(mParameters.toUtf8());
-    if (!document.isObject())
-        return;
+    if (parameters.contains("launchedAtBoot") && parameters["launchedAtBoot"].isBool())
+        mLaunchedAtBoot = parameters["launchedAtBoot"].toBool();
 
-    QJsonObject rootObject = document.object();
-    if (rootObject.contains("launchedAtBoot") && rootObject["launchedAtBoot"].isBool())
-        mLaunchedAtBoot = rootObject["launchedAtBoot"].toBool();
+    if (parameters.contains("loadOnFirstShow") && parameters["loadOnFirstShow"].isBool())
+        mLoadOnFirstShow = parameters["loadOnFirstShow"].toBool();
 }
 
 void WebApplication::changeActivityFocus(bool focus)
 {
+    if (!mActivity)
+        return;
+
     if (focus)
-        mActivity.focus();
+        mActivity->focus();
     else
-        mActivity.unfocus();
+        mActivity->unfocus();
+}
+
+bool WebApplication::prelaunched() const
+{
+    return mPrelaunch != PrelaunchNone;
+}
+
+WebApplication::Prelaunch WebApplication::prelaunch() const
+{
+    return mPrelaunch;
+}
+
+void WebApplication::adopt(int64_t processId, const QJsonValue &parameters, const LaunchTimeline &timeline)
+{
+    if (mPrelaunch == PrelaunchNone)
+        return;
+
+    qDebug() << __PRETTY_FUNCTION__ << "Adopting prelaunched application" << mDescription.id()
+             << "as process" << processId;
+
+    mPrelaunch = PrelaunchNone;
+
+    mProcessId = processId;
+    mIdentifier = QString("%1 %2").arg(mDescription.id()).arg(mProcessId);
+    mActivity = new Activity(mIdentifier, mDescription.id(), mProcessId);
+    emit processIdChanged();
+    emit activityIdChanged();
+
+    // The time the application spent prelaunched doesn't count for the launch
+    mLaunchTimeline = timeline;
+
+    QString serializedParameters = LaunchRequest::parametersToString(parameters);
+    if (parameters.isObject())
+        processParameters(parameters.toObject());
+
+    mMainWindow->adopt();
+
+    // The application was started without any parameters so let it know
+    // about the ones it's launched with now
+    if (!serializedParameters.isEmpty() && serializedParameters != "{}")
+        relaunch(serializedParameters);
 }
 
 void WebApplication::relaunch(const QString &parameters)
@@ -178,6 +243,14 @@ void WebApplication::relaunch(const QString &parameters)
     mParameters = parameters;
     emit parametersChanged();
 
+    // An application which wasn't shown yet doesn't have any web content
+    // loaded. Showing it will load the content which then picks up the new
+    // parameters on its own.
+    if (loadOnFirstShow() && !mMainWindow->visible()) {
+        mMainWindow->show();
+        return;
+    }
+
     mMainWindow->executeScript(QString("Mojo.relaunch();"));
 }
 
@@ -361,7 +434,7 @@ QString WebApplication::userAgent() const
 
 int WebApplication::activityId() const
 {
-    return mActivity.id();
+    return mActivity ? mActivity->id() : -1;
 }
 
 bool WebApplication::loadingAnimationDisabled() const
@@ -377,11 +450,70 @@ bool WebApplication::allowCrossDomainAccess() const
     return mDescription.allowCrossDomainAccess();
 }
 
+bool WebApplication::loadOnFirstShow() const
+{
+    // The launcher is always started at boot but not shown before the user
+    // asks for it
+    return mLoadOnFirstShow || mDescription.loadOnFirstShow() || isLauncher();
+}
+
 ApplicationDescription WebApplication::desc() const
 {
     return mDescription;
 }
 
+WebAppManager* WebApplication::launcher() const
+{
+    return mLauncher;
+}
+
+LaunchTimeline WebApplication::launchTimeline() const
+{
+    return mLaunchTimeline;
+}
+
+void WebApplication::markLaunchPhase(LaunchTimeline::Phase phase)
+{
+    if (mLaunchTimeline.reached(phase))
+        return;
+
+    mLaunchTimeline.mark(phase);
+
+    if (phase == LaunchTimeline::PhaseStageReady)
+        qDebug() << "Launch of" << id() << "took" << mLaunchTimeline.summary();
+
+    emit launchPhaseReached(phase);
+}
+
+void WebApplication::markRevealed(const QString &reason)
+{
+    if (mLaunchTimeline.reached(LaunchTimeline::PhaseRevealed))
+        return;
+
+    mLaunchTimeline.mark(LaunchTimeline::PhaseRevealed);
+    mLaunchTimeline.setRevealReason(reason);
+
+    qint64 latency = -1;
+    if (mLaunchTimeline.reached(LaunchTimeline::PhaseLoadSucceeded))
+        latency = mLaunchTimeline.timestamp(LaunchTimeline::PhaseRevealed) -
+                  mLaunchTimeline.timestamp(LaunchTimeline::PhaseLoadSucceeded);
+
+    qDebug() << "Revealed window of" << id() << "because of" << reason
+             << (latency >= 0 ? QString("%1ms after load succeeded").arg(latency / 1000.0, 0, 'f', 1)
+                              : QString("before load succeeded"));
+}
+
+void WebApplication::markLoadFailed()
+{
+    // A failure after the initial load succeeded doesn't affect the launch
+    if (mLaunchTimeline.reached(LaunchTimeline::PhaseLoadSucceeded))
+        return;
+
+    qWarning() << "Failed to load" << id();
+
+    emit loadFailed();
+}
+
 bool WebApplication::isLauncher() const
 {
     return mDescription.id() == "com.palm.launcher";
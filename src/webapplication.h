@@ -20,12 +20,15 @@
 
 #include <QQuickView>
 #include <QMap>
+#include <QJsonValue>
+#include <QJsonObject>
 #ifndef WITH_UNMODIFIED_QTWEBKIT
 #include <QtWebKit/private/qwebnewpagerequest_p.h>
 #endif
 
 #include "applicationdescription.h"
 #include "activity.h"
+#include "launchtimeline.h"
 
 namespace luna
 {
@@ -38,11 +41,11 @@ class WebApplication : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(QString id READ id CONSTANT)
-    Q_PROPERTY(int64_t processId READ processId CONSTANT)
+    Q_PROPERTY(int64_t processId READ processId NOTIFY processIdChanged)
     Q_PROPERTY(QUrl url READ url CONSTANT)
     Q_PROPERTY(QUrl icon READ icon CONSTANT)
-    Q_PROPERTY(QString identifier READ identifier CONSTANT)
-    Q_PROPERTY(int activityId READ activityId CONSTANT)
+    Q_PROPERTY(QString identifier READ identifier NOTIFY processIdChanged)
+    Q_PROPERTY(int activityId READ activityId NOTIFY activityIdChanged)
     Q_PROPERTY(QString parameters READ parameters NOTIFY parametersChanged)
     Q_PROPERTY(bool headless READ headless CONSTANT)
     Q_PROPERTY(bool privileged READ privileged CONSTANT)
@@ -51,11 +54,20 @@ class WebApplication : public QObject
     Q_PROPERTY(QString userAgent READ userAgent CONSTANT)
     Q_PROPERTY(bool loadingAnimationDisabled READ loadingAnimationDisabled CONSTANT)
     Q_PROPERTY(bool allowCrossDomainAccess READ allowCrossDomainAccess CONSTANT)
+    Q_PROPERTY(bool loadOnFirstShow READ loadOnFirstShow CONSTANT)
 
 public:
+    enum Prelaunch
+    {
+        PrelaunchNone = 0,
+        PrelaunchPredicted,
+        PrelaunchHinted
+    };
+
     WebApplication(WebAppManager *launcher, const QUrl& url, const QString& windowType,
-                   const ApplicationDescription& desc, const QString& parameters,
-                   const int64_t processId, QObject *parent = 0);
+                   const ApplicationDescription& desc, const QJsonValue& parameters,
+                   const int64_t processId, const LaunchTimeline &timeline = LaunchTimeline(),
+                   Prelaunch prelaunch = PrelaunchNone, QObject *parent = 0);
     virtual ~WebApplication();
 
     QString id() const;
@@ -73,13 +85,24 @@ public:
     QString userAgent() const;
     bool loadingAnimationDisabled() const;
     bool allowCrossDomainAccess() const;
+    bool loadOnFirstShow() const;
     ApplicationDescription desc() const;
+    WebAppManager* launcher() const;
+    LaunchTimeline launchTimeline() const;
+
+    void markLaunchPhase(LaunchTimeline::Phase phase);
+    void markRevealed(const QString &reason);
+    void markLoadFailed();
 
     void changeActivityFocus(bool focus);
 
     bool validateResourcePath(const QString& path);
 
-    void relaunch(const QString &parameters);
+    virtual void relaunch(const QString &parameters);
+
+    bool prelaunched() const;
+    Prelaunch prelaunch() const;
+    void adopt(int64_t processId, const QJsonValue &parameters, const LaunchTimeline &timeline);
 
 #ifndef WITH_UNMODIFIED_QTWEBKIT
     void createWindow(QWebNewPageRequest *request);
@@ -89,7 +112,7 @@ public:
 
     void kill();
 
-    void clearMemoryCaches();
+    virtual void clearMemoryCaches();
 
 public Q_SLOTS:
     bool isLauncher() const;
@@ -97,9 +120,19 @@ public Q_SLOTS:
 Q_SIGNALS:
     void closed();
     void parametersChanged();
+    void processIdChanged();
+    void activityIdChanged();
+    void launchPhaseReached(LaunchTimeline::Phase phase);
+    void loadFailed();
+
+protected:
+    // Creates neither an activity nor a window; see WebAppManager::createApplication
+    WebApplication(WebAppManager *launcher, const ApplicationDescription& desc,
+                   const QJsonValue& parameters, const int64_t processId,
+                   const LaunchTimeline &timeline, Prelaunch prelaunch, QObject *parent = 0);
 
 private:
-    void processParameters();
+    void processParameters(const QJsonObject &parameters);
 
 private:
     WebAppManager *mLauncher;
@@ -110,8 +143,11 @@ private:
     WebApplicationWindow *mMainWindow;
     QList<WebApplicationWindow*> mChildWindows;
     bool mLaunchedAtBoot;
+    bool mLoadOnFirstShow;
+    Prelaunch mPrelaunch;
     bool mPrivileged;
-    Activity mActivity;
+    Activity *mActivity;
+    LaunchTimeline mLaunchTimeline;
 };
 
 } // namespace luna
@@ -18,14 +18,14 @@
 #include <QDebug>
 #include <QQmlContext>
 #include <QQmlComponent>
+#include <QQmlIncubator>
 #include <QtWebKit/private/qquickwebview_p.h>
 #ifndef WITH_UNMODIFIED_QTWEBKIT
 #include <QtWebKit/private/qwebnewpagerequest_p.h>
 #endif
 #include <QtGui/QGuiApplication>
 #include <QtGui/qpa/qplatformnativeinterface.h>
-#include <QJsonDocument>
-#include <QJsonObject>
+#include <QJsonArray>
 #include <QTimer>
 
 #include <QScreen>
@@ -35,14 +35,67 @@
 #include "applicationdescription.h"
 #include "webapplication.h"
 #include "webapplicationwindow.h"
+#include "webappmanager.h"
+#include "windowpool.h"
+#include "sparewebprocess.h"
+#include "qmlcomponentcache.h"
+#include "incubationcontroller.h"
+#include "jsonreader.h"
 
 #include "extensions/palmsystemextension.h"
 #include "extensions/wifimanager.h"
 #include "extensions/inappbrowserextension.h"
 
+/* Last resort for applications which called stagePreparing but never call
+ * stageReady and never paint anything either */
+#define STAGE_READY_TIMEOUT     3000
+
+#define APPLICATION_CONTAINER_URL       "qrc:///qml/ApplicationContainer.qml"
+
 namespace luna
 {
 
+static bool revealOnFirstPaint = true;
+static bool splashEnabled = true;
+
+/* The web view takes the kind of viewport from a global flag when it's created
+ * which happens somewhere while the container is incubated. Only one container
+ * is therefore incubated at a time with the flag set for its application.
+ * Everything else creating a web view does so synchronously and restores the
+ * flag afterwards so it never changes while a container is incubated. */
+static WebApplicationWindow *incubatingWindow = 0;
+static QList<WebApplicationWindow*> incubationQueue;
+
+class ContainerIncubator : public QQmlIncubator
+{
+public:
+    ContainerIncubator(WebApplicationWindow *window) :
+        QQmlIncubator(QQmlIncubator::Asynchronous),
+        mWindow(window)
+    {
+    }
+
+protected:
+    void statusChanged(Status status)
+    {
+        if (status == QQmlIncubator::Ready || status == QQmlIncubator::Error)
+            mWindow->onContainerIncubated();
+    }
+
+private:
+    WebApplicationWindow *mWindow;
+};
+
+void WebApplicationWindow::setRevealOnFirstPaint(bool enabled)
+{
+    revealOnFirstPaint = enabled;
+}
+
+void WebApplicationWindow::setSplashEnabled(bool enabled)
+{
+    splashEnabled = enabled;
+}
+
 WebApplicationWindow::WebApplicationWindow(WebApplication *application, const QUrl& url,
                                            const QString& windowType, const QSize& size,
                                            bool headless,
@@ -51,9 +104,12 @@ WebApplicationWindow::WebApplicationWindow(WebApplication *application, const QU
     ApplicationEnvironment(parent),
     mApplication(application),
     mEngine(0),
+    mContext(0),
+    mOwnsEngine(false),
     mRootItem(0),
     mWindow(0),
     mHeadless(headless),
+    mWebView(0),
     mUrl(url),
     mWindowType(windowType),
     mKeepAlive(false),
@@ -64,7 +120,10 @@ WebApplicationWindow::WebApplicationWindow(WebApplication *application, const QU
     mWindowId(0),
     mParentWindowId(parentWindowId),
     mLoadingAnimationDisabled(false),
-    mLaunchedHidden(application->id() == "com.palm.launcher")
+    mLoadOnFirstShow(application->loadOnFirstShow()),
+    mLoadSucceeded(false),
+    mFirstPaint(false),
+    mIncubator(0)
 {
     qDebug() << __PRETTY_FUNCTION__ << this << size;
 
@@ -85,7 +144,19 @@ WebApplicationWindow::~WebApplicationWindow()
 
     mExtensions.clear();
 
-    if (mHeadless)
+    incubationQueue.removeAll(this);
+
+    if (mIncubator) {
+        mIncubator->clear();
+        delete mIncubator;
+    }
+
+    finishIncubation();
+
+    if (mHeadless && mRootItem)
+        delete mRootItem;
+
+    if (mOwnsEngine)
         delete mEngine;
 
     if (mWindow)
@@ -141,11 +212,11 @@ void WebApplicationWindow::onWindowPropertyChanged(QPlatformWindow *window, cons
 
 void WebApplicationWindow::configureQmlEngine()
 {
-    if (!mEngine)
+    if (!mContext)
         return;
 
-    mEngine->rootContext()->setContextProperty("webApp", mApplication);
-    mEngine->rootContext()->setContextProperty("webAppWindow", this);
+    mContext->setContextProperty("webApp", mApplication);
+    mContext->setContextProperty("webAppWindow", this);
 }
 
 void WebApplicationWindow::createAndSetup()
@@ -161,40 +232,70 @@ void WebApplicationWindow::createAndSetup()
     if (mHeadless) {
         qDebug() << __PRETTY_FUNCTION__ << "Creating application container for headless ...";
 
-        mEngine = new QQmlEngine;
+        // With a shared engine we only need a context of our own for the
+        // application specific properties
+        mEngine = mApplication->launcher()->windowPool()->sharedEngine();
+        if (mEngine) {
+            mContext = new QQmlContext(mEngine->rootContext(), this);
+        }
+        else {
+            mEngine = new QQmlEngine;
+            mOwnsEngine = true;
+            mContext = mEngine->rootContext();
+        }
+
         configureQmlEngine();
 
-        QQmlComponent component(mEngine, QUrl(QString("qrc:///qml/ApplicationContainer.qml")));
-        mRootItem = qobject_cast<QQuickItem*>(component.create());
+        mApplication->markLaunchPhase(LaunchTimeline::PhaseWindowCreated);
+
+        bool flickableViewportEnabled = QQuickWebViewExperimental::flickableViewportEnabled();
+        QQuickWebViewExperimental::setFlickableViewportEnabled(mApplication->desc().flickable());
+
+        QQmlComponent *component = QmlComponentCache::component(mEngine,
+                                        QUrl(QString(APPLICATION_CONTAINER_URL)));
+        mRootItem = qobject_cast<QQuickItem*>(component->create(mContext));
+
+        QQuickWebViewExperimental::setFlickableViewportEnabled(flickableViewportEnabled);
+
+        mApplication->markLaunchPhase(LaunchTimeline::PhaseContainerLoaded);
     }
     else {
-        QQuickWebViewExperimental::setFlickableViewportEnabled(mApplication->desc().flickable());
+        bool flickable = mApplication->desc().flickable();
+
+        // The spare window has a web view with a running web process waiting
+        // for us. As its web view was created without a flickable viewport and
+        // is created right away we can't use it for every application.
+        WindowPool *windowPool = mApplication->launcher()->windowPool();
+
+        // Nobody waits for applications loaded on first show or prelaunched
+        // ones so they leave the spare and the pool to the ones somebody does.
+        // A hinted prelaunch is for a launch which is just about to happen.
+        bool background = mLoadOnFirstShow ||
+                          mApplication->prelaunch() == WebApplication::PrelaunchPredicted;
+
+        bool adoptedSpare = false;
+        if (!flickable && !background) {
+            mWindow = mApplication->launcher()->spareWebProcess()->take();
+            adoptedSpare = (mWindow != 0);
+        }
 
-        mWindow = new QQuickView;
-        mWindow->installEventFilter(this);
+        // Otherwise prefer a pre-created window from the pool which already has
+        // its platform window created and the application container compiled
+        if (!mWindow && !background)
+            mWindow = windowPool->take();
+        if (!mWindow)
+            mWindow = windowPool->createWindow();
 
+        mWindow->installEventFilter(this);
 
         mEngine = mWindow->engine();
+        mContext = windowPool->contextForWindow(mWindow);
         configureQmlEngine();
 
         connect(mWindow, &QObject::destroyed,  [=](QObject *obj) {
             qDebug() << "Window destroyed";
         });
 
-        mWindow->setColor(Qt::transparent);
-
-        mWindow->reportContentOrientationChange(QGuiApplication::primaryScreen()->primaryOrientation());
-
-        mWindow->setSurfaceType(QSurface::OpenGLSurface);
-        QSurfaceFormat surfaceFormat = mWindow->format();
-        surfaceFormat.setAlphaBufferSize(8);
-        surfaceFormat.setRenderableType(QSurfaceFormat::OpenGLES);
-        mWindow->setFormat(surfaceFormat);
-
-        // make sure the platform window gets created to be able to set it's
-        // window properties
-        mWindow->create();
-
         // set different information bits for our window
         setWindowProperty(QString("_LUNE_WINDOW_TYPE"), QVariant(mWindowType));
         setWindowProperty(QString("_LUNE_WINDOW_PARENT_ID"), QVariant(mParentWindowId));
@@ -203,19 +304,86 @@ void WebApplicationWindow::createAndSetup()
         setWindowProperty(QString("_LUNE_APP_ID"), QVariant(mApplication->id()));
 
         connect(mWindow, SIGNAL(visibleChanged(bool)), this, SLOT(onVisibleChanged(bool)));
+        connect(mWindow, SIGNAL(frameSwapped()), this, SLOT(onFrameSwapped()));
 
         QPlatformNativeInterface *nativeInterface = QGuiApplication::platformNativeInterface();
         connect(nativeInterface, SIGNAL(windowPropertyChanged(QPlatformWindow*, const QString&)),
                 this, SLOT(onWindowPropertyChanged(QPlatformWindow*, const QString&)));
 
-        mWindow->setSource(QUrl(QString("qrc:///qml/ApplicationContainer.qml")));
-
-        mRootItem = mWindow->rootObject();
+        mApplication->markLaunchPhase(LaunchTimeline::PhaseWindowCreated);
 
         mWindow->resize(mSize);
+
+        showSplash();
+
+        if (adoptedSpare) {
+            mRootItem = mWindow->rootObject();
+            QMetaObject::invokeMethod(mRootItem, "bindApplication");
+
+            mApplication->markLaunchPhase(LaunchTimeline::PhaseContainerLoaded);
+        }
+        else {
+            // The container is created asynchronously to not block the other
+            // windows; setup continues in onContainerIncubated
+            incubateContainer();
+        }
     }
 }
 
+void WebApplicationWindow::incubateContainer()
+{
+    if (incubatingWindow) {
+        qDebug() << __PRETTY_FUNCTION__ << "id" << mApplication->id() << "waiting for another container to finish";
+        incubationQueue.append(this);
+        return;
+    }
+
+    incubatingWindow = this;
+
+    QQuickWebViewExperimental::setFlickableViewportEnabled(mApplication->desc().flickable());
+
+    QQmlComponent *component = QmlComponentCache::component(mEngine, QUrl(QString(APPLICATION_CONTAINER_URL)));
+    if (!component->isReady()) {
+        qWarning() << "Failed to load application container for" << mApplication->id();
+        finishIncubation();
+        return;
+    }
+
+    mIncubator = new ContainerIncubator(this);
+    component->create(*mIncubator, mContext);
+}
+
+void WebApplicationWindow::onContainerIncubated()
+{
+    if (mIncubator->isError()) {
+        qWarning() << "Failed to create application container for" << mApplication->id()
+                   << ":" << mIncubator->errors();
+        finishIncubation();
+        return;
+    }
+
+    QUrl url(QString(APPLICATION_CONTAINER_URL));
+    QObject *rootObject = mIncubator->object();
+
+    mWindow->setContent(url, QmlComponentCache::component(mEngine, url), rootObject);
+    mRootItem = qobject_cast<QQuickItem*>(rootObject);
+
+    mApplication->markLaunchPhase(LaunchTimeline::PhaseContainerLoaded);
+
+    finishIncubation();
+}
+
+void WebApplicationWindow::finishIncubation()
+{
+    if (incubatingWindow != this)
+        return;
+
+    incubatingWindow = 0;
+
+    if (!incubationQueue.isEmpty())
+        incubationQueue.takeFirst()->incubateContainer();
+}
+
 void WebApplicationWindow::configureWebView(QQuickItem *webViewItem)
 {
     qDebug() << __PRETTY_FUNCTION__ << "Configuring application webview ...";
@@ -230,6 +398,8 @@ void WebApplicationWindow::configureWebView(QQuickItem *webViewItem)
 
     connect(mWebView, SIGNAL(loadingChanged(QWebLoadRequest*)),
             this, SLOT(onLoadingChanged(QWebLoadRequest*)));
+    connect(mWebView->experimental(), SIGNAL(loadVisuallyCommitted()),
+            this, SLOT(onLoadVisuallyCommitted()));
 
 #ifndef WITH_UNMODIFIED_QTWEBKIT
     connect(mWebView->experimental(), SIGNAL(createNewPage(QWebNewPageRequest*)),
@@ -242,6 +412,8 @@ void WebApplicationWindow::configureWebView(QQuickItem *webViewItem)
     if (mTrustScope == TrustScopeSystem)
         loadAllExtensions();
 
+    mApplication->markLaunchPhase(LaunchTimeline::PhaseWebViewConfigured);
+
    mWebView->setUrl(mUrl);
 
     /* If we're running a remote site mark the window as fully loaded */
@@ -253,14 +425,122 @@ void WebApplicationWindow::onStageReadyTimeout()
 {
     qDebug() << __PRETTY_FUNCTION__;
 
+    if (!mLoadOnFirstShow)
+        reveal("timeout");
+
     stageReady();
 }
 
+void WebApplicationWindow::onLoadVisuallyCommitted()
+{
+    qDebug() << __PRETTY_FUNCTION__ << "id" << mApplication->id();
+
+    mFirstPaint = true;
+
+    // The page painted some real content after it was loaded but the
+    // application still didn't tell us it's ready. Show what we have instead
+    // of waiting for the stage ready timeout to fire.
+    if (revealOnFirstPaint && mLoadSucceeded && mStagePreparing && !mStageReady &&
+        !mHeadless && !mApplication->hasRemoteEntryPoint())
+        reveal("firstPaint");
+}
+
+void WebApplicationWindow::showSplash()
+{
+    // Applications which don't want a loading animation don't get a splash
+    // either and the ones loaded on first show or prelaunched ones aren't
+    // shown right away
+    if (!splashEnabled || mWindowType != "card" || mLoadingAnimationDisabled ||
+        mApplication->loadingAnimationDisabled() || mLoadOnFirstShow ||
+        mApplication->prelaunched())
+        return;
+
+    if (!mWindow || mSplashItem)
+        return;
+
+    QQmlComponent *component = QmlComponentCache::component(mEngine, QUrl(QString("qrc:///qml/Splash.qml")));
+    mSplashItem = qobject_cast<QQuickItem*>(component->create(mContext));
+    if (!mSplashItem)
+        return;
+
+    mSplashItem->setParent(mWindow);
+    mSplashItem->setParentItem(mWindow->contentItem());
+    mSplashItem->setProperty("icon", QVariant(mApplication->icon()));
+
+    connect(mSplashItem, SIGNAL(dismissed()), mSplashItem, SLOT(deleteLater()));
+
+    // The splash stands in for the content until we reveal it so the window
+    // can be shown right away
+    mWindow->show();
+}
+
+void WebApplicationWindow::adopt()
+{
+    // If the content was ready already while we were prelaunched we can show
+    // it right away, otherwise the splash bridges the time until it is
+    if (!mPendingRevealReason.isEmpty()) {
+        reveal(mPendingRevealReason);
+        mPendingRevealReason = QString();
+        return;
+    }
+
+    showSplash();
+}
+
+bool WebApplicationWindow::revealed() const
+{
+    return mWindow && mWindow->isVisible() && !mSplashItem;
+}
+
+void WebApplicationWindow::reveal(const QString &reason)
+{
+    if (!mWindow || revealed())
+        return;
+
+    mStageReadyTimer.stop();
+
+    // A prelaunched application stays hidden until it's adopted
+    if (mApplication->prelaunched()) {
+        if (mPendingRevealReason.isEmpty())
+            mPendingRevealReason = reason;
+        return;
+    }
+
+    mApplication->markRevealed(reason);
+
+    // With a splash the window is already visible and we only have to fade
+    // over to the content
+    if (mSplashItem) {
+        QMetaObject::invokeMethod(mSplashItem, "dismiss");
+        mSplashItem = 0;
+    }
+
+    mWindow->show();
+}
+
 void WebApplicationWindow::onVisibleChanged(bool visible)
 {
     qDebug() << __PRETTY_FUNCTION__ << visible;
 
+    // The container creates the web view of an application loaded on first
+    // show right away once we tell it we're visible
+    bool createsWebView = visible && mLoadOnFirstShow && !mWebView;
+    bool flickableViewportEnabled = QQuickWebViewExperimental::flickableViewportEnabled();
+    if (createsWebView)
+        QQuickWebViewExperimental::setFlickableViewportEnabled(mApplication->desc().flickable());
+
     emit visibleChanged();
+
+    if (createsWebView)
+        QQuickWebViewExperimental::setFlickableViewportEnabled(flickableViewportEnabled);
+}
+
+void WebApplicationWindow::onFrameSwapped()
+{
+    // We're only interested in the very first frame of the window
+    disconnect(mWindow, SIGNAL(frameSwapped()), this, SLOT(onFrameSwapped()));
+
+    mApplication->markLaunchPhase(LaunchTimeline::PhaseFirstFrame);
 }
 
 void WebApplicationWindow::setupPage()
@@ -301,12 +581,17 @@ void WebApplicationWindow::onLoadingChanged(QWebLoadRequest *request)
 
     switch (request->status()) {
     case QQuickWebView::LoadStartedStatus:
+        mApplication->markLaunchPhase(LaunchTimeline::PhaseLoadStarted);
         setupPage();
         return;
     case QQuickWebView::LoadStoppedStatus:
+        return;
     case QQuickWebView::LoadFailedStatus:
+        mApplication->markLoadFailed();
         return;
     case QQuickWebView::LoadSucceededStatus:
+        mApplication->markLaunchPhase(LaunchTimeline::PhaseLoadSucceeded);
+        mLoadSucceeded = true;
         break;
     }
 
@@ -322,9 +607,16 @@ void WebApplicationWindow::onLoadingChanged(QWebLoadRequest *request)
     // if the framework  called us with an explicit stagePreparing call we
     // will wait for the call to stageReady to come in
     if (mStagePreparing && !mStageReady) {
-        if (!mWindow->isVisible() && !mStageReadyTimer.isActive()) {
+        // the page might already have painted its content before it finished
+        // loading so there is no reason to wait any longer
+        if (revealOnFirstPaint && mFirstPaint) {
+            reveal("firstPaint");
+            return;
+        }
+
+        if (!revealed() && !mStageReadyTimer.isActive()) {
             qDebug() << Q_FUNC_INFO << "id" << mApplication->id() << "kicking stage ready timer";
-            mStageReadyTimer.start(3000);
+            mStageReadyTimer.start(STAGE_READY_TIMEOUT);
         }
         else {
             qDebug() << Q_FUNC_INFO << "id" << mApplication->id() << "omitting stage ready timer as alreay active or window visible";
@@ -332,8 +624,7 @@ void WebApplicationWindow::onLoadingChanged(QWebLoadRequest *request)
         return;
     }
 
-    if (!mWindow->isVisible())
-        mWindow->show();
+    reveal("loadSucceeded");
 }
 
 #ifndef WITH_UNMODIFIED_QTWEBKIT
@@ -356,33 +647,32 @@ void WebApplicationWindow::onSyncMessageReceived(const QVariantMap& message, QSt
 
     QString data = message.value("data").toString();
 
-    QJsonDocument document = QJsonDocument::fromJson(data.toUtf8());
+    JsonReader reader(data.toUtf8());
 
-    if (!document.isObject())
+    if (!reader.isValid())
         return;
 
-    QJsonObject rootObject = document.object();
-
     QString messageType;
-    if (!rootObject.contains("messageType") || !rootObject.value("messageType").isString())
+    if (!reader.isString("messageType"))
         return;
 
-    messageType = rootObject.value("messageType").toString();
+    messageType = reader.string("messageType");
     if (messageType != "callSyncExtensionFunction")
         return;
 
-    if (!(rootObject.contains("extension") && rootObject.value("extension").isString()) ||
-        !(rootObject.contains("func") && rootObject.value("func").isString()) ||
-        !(rootObject.contains("params") && rootObject.value("params").isArray()))
+    if (!reader.isString("extension") || !reader.isString("func") || !reader.isArray("params"))
         return;
 
-    QString extensionName = rootObject.value("extension").toString();
-    QString funcName = rootObject.value("func").toString();
-    QJsonArray params = rootObject.value("params").toArray();
+    QString extensionName = reader.string("extension");
+    QString funcName = reader.string("func");
 
     if (!mExtensions.contains(extensionName))
         return;
 
+    // Only the parameters are handed on to the extension so they're the only
+    // part converted to Qt's types
+    QJsonArray params = reader.value("params").toArray();
+
     BaseExtension *extension = mExtensions.value(extensionName);
     response = extension->handleSynchronousCall(funcName, params);
 }
@@ -461,8 +751,10 @@ void WebApplicationWindow::stageReady()
     mStagePreparing = false;
     mStageReady = true;
 
-    if (mWindow && !mLaunchedHidden && !mWindow->isVisible())
-        mWindow->show();
+    mApplication->markLaunchPhase(LaunchTimeline::PhaseStageReady);
+
+    if (!mLoadOnFirstShow)
+        reveal("stageReady");
 
     emit readyChanged();
 
@@ -623,6 +915,11 @@ QQmlEngine* WebApplicationWindow::qmlEngine() const
     return mEngine;
 }
 
+QQmlContext* WebApplicationWindow::qmlContext() const
+{
+    return mContext;
+}
+
 QQuickItem* WebApplicationWindow::rootItem() const
 {
     return mRootItem;
@@ -22,6 +22,7 @@
 #include <QQmlApplicationEngine>
 #include <QQuickWindow>
 #include <QTimer>
+#include <QPointer>
 
 #include <QtWebKit/private/qquickwebview_p.h>
 #ifndef WITH_UNMODIFIED_QTWEBKIT
@@ -33,12 +34,14 @@
 
 class QQuickView;
 class QQuickItem;
+class QQmlContext;
 
 namespace luna
 {
 
 class BaseExtension;
 class WebApplication;
+class ContainerIncubator;
 
 enum TrustScope
 {
@@ -91,6 +94,7 @@ public:
     bool hasFocus() const;
 
     QQmlEngine* qmlEngine() const;
+    QQmlContext* qmlContext() const;
     QQuickItem* rootItem() const;
 
     QList<QUrl> userScripts() const;
@@ -108,6 +112,11 @@ public:
 
     Q_INVOKABLE void configureWebView(QQuickItem *webViewItem);
 
+    void adopt();
+
+    static void setRevealOnFirstPaint(bool enabled);
+    static void setSplashEnabled(bool enabled);
+
 Q_SIGNALS:
     void javaScriptExecNeeded(const QString &script);
     void extensionWantsToBeAdded(const QString &name, QObject *object);
@@ -128,14 +137,22 @@ private Q_SLOTS:
     void onSyncMessageReceived(const QVariantMap& message, QString& response);
 #endif
     void onLoadingChanged(QWebLoadRequest *request);
+    void onLoadVisuallyCommitted();
     void onStageReadyTimeout();
     void onVisibleChanged(bool visible);
     void onWindowPropertyChanged(QPlatformWindow *window, const QString &name);
+    void onFrameSwapped();
+
+private:
+    friend class ContainerIncubator;
+    void onContainerIncubated();
 
 private:
     WebApplication *mApplication;
     QMap<QString, BaseExtension*> mExtensions;
     QQmlEngine *mEngine;
+    QQmlContext *mContext;
+    bool mOwnsEngine;
     QQuickItem *mRootItem;
     QQuickView *mWindow;
     bool mHeadless;
@@ -152,10 +169,17 @@ private:
     int mWindowId;
     int mParentWindowId;
     bool mLoadingAnimationDisabled;
-    bool mLaunchedHidden;
+    bool mLoadOnFirstShow;
+    bool mLoadSucceeded;
+    bool mFirstPaint;
+    ContainerIncubator *mIncubator;
+    QPointer<QQuickItem> mSplashItem;
+    QString mPendingRevealReason;
 
     void assignCorrectTrustScope();
     void createAndSetup();
+    void incubateContainer();
+    void finishIncubation();
     void configureQmlEngine();
     void loadAllExtensions();
     void addExtension(BaseExtension *extension);
@@ -165,6 +189,9 @@ private:
     void updateWindowProperty(const QString &name);
     void setupPage();
     void notifyAppAboutFocusState(bool focus);
+    void reveal(const QString &reason);
+    bool revealed() const;
+    void showSplash();
 };
 
 } // namespace luna
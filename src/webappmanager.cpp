@@ -24,11 +24,17 @@
 #include "webappmanager.h"
 #include "webapplication.h"
 #include "webappmanagerservice.h"
+#include "launchtimeline.h"
+#include "windowpool.h"
+#include "sparewebprocess.h"
+#include "launchscheduler.h"
+#include "prelauncher.h"
+#include "applicationregistry.h"
 
 namespace luna
 {
 
-WebAppManager::WebAppManager(int &argc, char **argv)
+WebAppManager::WebAppManager(int &argc, char **argv, bool registerOnBus)
     : QGuiApplication(argc, argv)
 {
     setApplicationName("LunaWebAppMgr");
@@ -38,7 +44,11 @@ WebAppManager::WebAppManager(int &argc, char **argv)
 
     connect(this, SIGNAL(aboutToQuit()), this, SLOT(onAboutToQuit()));
 
-    mService = new WebAppManagerService(this);
+    mService = new WebAppManagerService(this, registerOnBus);
+    mWindowPool = new WindowPool(this);
+    mSpareWebProcess = new SpareWebProcess(mWindowPool, this);
+    mLaunchScheduler = new LaunchScheduler(this, this);
+    mPrelauncher = new Prelauncher(this, this);
 }
 
 WebAppManager::~WebAppManager()
@@ -57,71 +67,139 @@ bool WebAppManager::validateApplication(const ApplicationDescription& desc)
     return true;
 }
 
-WebApplication* WebAppManager::launchApp(const QString &appDesc, const QString &parameters, int64_t processId)
+ApplicationDescriptionPtr WebAppManager::lookupDescription(const LaunchRequest &request, bool &valid)
 {
-    ApplicationDescription desc(appDesc);
-
-    if (!validateApplication(desc)) {
-        qWarning("Got invalid application description for app %s",
-                 desc.id().toUtf8().constData());
-        return NULL;
+    // Relaunches and multiple launches of the same application come with the
+    // very same description so we only parse and check it once. Invalid
+    // descriptions aren't cached as the application may be installed later
+    // on; one removed in the meantime fails to load its entry point instead.
+    ApplicationDescriptionPtr desc = mDescriptionCache.lookup(request.appId(), request.appDescHash());
+    if (desc) {
+        valid = true;
+        return desc;
     }
 
-    if (mApplications.contains(desc.id())) {
-        WebApplication *app = mApplications.value(desc.id());
-        app->relaunch(parameters);
-        return app;
+    desc = ApplicationDescriptionPtr(new ApplicationDescription(request.appDesc()));
+
+    valid = validateApplication(*desc);
+    if (valid)
+        mDescriptionCache.insert(request.appDescHash(), desc);
+
+    return desc;
+}
+
+WebApplication* WebAppManager::launchApp(const LaunchRequest &request, const ApplicationDescriptionPtr &desc)
+{
+    // The launch scheduler already looked up and checked the description
+    LaunchTimeline timeline;
+    timeline.mark(LaunchTimeline::PhaseReceived, request.receivedAt());
+    timeline.mark(LaunchTimeline::PhaseDescriptionParsed);
+
+    WebApplication *runningApp = mApplications.findByAppId(desc->id());
+    if (runningApp) {
+        // We guessed right and the application is already waiting for us
+        if (runningApp->prelaunched()) {
+            int64_t placeholderProcessId = runningApp->processId();
+            runningApp->adopt(request.processId(), request.parameters(), timeline);
+            mApplications.updateProcessId(runningApp, placeholderProcessId);
+            mPrelauncher->applicationAdopted(runningApp->id());
+
+            mService->notifyAppHasStarted(runningApp->id(), runningApp->processId());
+            mPrelauncher->applicationStarted(runningApp->id());
+
+            return runningApp;
+        }
+
+        runningApp->relaunch(LaunchRequest::parametersToString(request.parameters()));
+        return runningApp;
     }
 
     QString windowType = "card";
-    if (desc.id() == "com.palm.launcher")
+    if (desc->id() == "com.palm.launcher")
         windowType = "launcher";
 
-    QUrl entryPoint = desc.entryPoint();
-    WebApplication *app = new WebApplication(this, entryPoint, windowType,
-                                             desc, parameters, processId);
+    QUrl entryPoint = desc->entryPoint();
+    WebApplication *app = createApplication(entryPoint, windowType, *desc, request.parameters(),
+                                            request.processId(), timeline, WebApplication::PrelaunchNone);
     connect(app, SIGNAL(closed()), this, SLOT(onApplicationClosed()));
 
     this->setQuitOnLastWindowClosed(false);
 
-    mApplications.insert(app->id(), app);
+    mApplications.add(app);
 
     mService->notifyAppHasStarted(app->id(), app->processId());
+    mPrelauncher->applicationStarted(app->id());
 
     return app;
 }
 
-WebApplication* WebAppManager::launchUrl(const QUrl &url, const QString &windowType,
-                               const QString &appDesc, const QString &parameters, int64_t processId)
+WebApplication* WebAppManager::launchUrl(const LaunchRequest &request, const ApplicationDescriptionPtr &desc)
 {
-    ApplicationDescription desc(appDesc);
+    LaunchTimeline timeline;
+    timeline.mark(LaunchTimeline::PhaseReceived, request.receivedAt());
+    timeline.mark(LaunchTimeline::PhaseDescriptionParsed);
 
-    if (!validateApplication(desc)) {
-        qWarning("Got invalid application description for app %s",
-                 desc.id().toUtf8().constData());
-        return NULL;
-    }
+    // A prelaunched application has loaded its entry point and not the URL
+    // we're asked for
+    mPrelauncher->discard(desc->id());
 
     // FIXME is this correct when launching an URL?
-    if (mApplications.contains(desc.id())) {
-        WebApplication *application = mApplications.value(desc.id());
-        application->relaunch(parameters);
+    WebApplication *application = mApplications.findByAppId(desc->id());
+    if (application) {
+        application->relaunch(LaunchRequest::parametersToString(request.parameters()));
         return application;
     }
 
-    QQuickWebViewExperimental::setFlickableViewportEnabled(desc.flickable());
-
-    WebApplication *app = new WebApplication(this, url, windowType, desc, parameters,
-                                             processId);
+    WebApplication *app = createApplication(request.url(), request.windowType(), *desc,
+                                            request.parameters(), request.processId(), timeline,
+                                            WebApplication::PrelaunchNone);
     connect(app, SIGNAL(closed()), this, SLOT(onApplicationClosed()));
 
-    mApplications.insert(app->id(), app);
+    mApplications.add(app);
 
     mService->notifyAppHasStarted(app->id(), app->processId());
+    mPrelauncher->applicationStarted(app->id());
 
     return app;
 }
 
+WebApplication* WebAppManager::prelaunchApp(const QString &appId, int64_t processId, bool hinted)
+{
+    if (mApplications.contains(appId))
+        return 0;
+
+    // We can only prelaunch applications we were asked to launch before as
+    // only then we know their description; cached ones were valid
+    ApplicationDescriptionPtr desc = mDescriptionCache.lookupByAppId(appId);
+    if (!desc)
+        return 0;
+
+    if (desc->headless() || desc->id() == "com.palm.launcher")
+        return 0;
+
+    LaunchTimeline timeline;
+    timeline.mark(LaunchTimeline::PhaseReceived);
+
+    WebApplication *app = createApplication(desc->entryPoint(), "card", *desc,
+                                            QJsonValue(QString("")), processId, timeline,
+                                            hinted ? WebApplication::PrelaunchHinted :
+                                                     WebApplication::PrelaunchPredicted);
+    connect(app, SIGNAL(closed()), this, SLOT(onApplicationClosed()));
+
+    mApplications.add(app);
+
+    return app;
+}
+
+WebApplication* WebAppManager::createApplication(const QUrl &url, const QString &windowType,
+                                                 const ApplicationDescription &desc,
+                                                 const QJsonValue &parameters, int64_t processId,
+                                                 const LaunchTimeline &timeline,
+                                                 WebApplication::Prelaunch prelaunch)
+{
+    return new WebApplication(this, url, windowType, desc, parameters, processId, timeline, prelaunch);
+}
+
 void WebAppManager::onAboutToQuit()
 {
 }
@@ -130,14 +208,18 @@ void WebAppManager::onApplicationClosed()
 {
     WebApplication *app = static_cast<WebApplication*>(sender());
 
-    if (!mApplications.contains(app->id())) {
+    if (!mApplications.contains(app)) {
         qWarning("BUG: Got close event from not running application!?");
         return;
     }
 
-    mApplications.remove(app->id());
+    mApplications.remove(app);
 
-    mService->notifyAppHasFinished(app->id(), app->processId());
+    // Nobody knows about prelaunched applications so nobody cares they're gone
+    if (app->prelaunched())
+        mPrelauncher->applicationClosed(app->id());
+    else
+        mService->notifyAppHasFinished(app->id(), app->processId());
 
     qDebug() << "Application" << app->id() << "was closed";
     delete app;
@@ -145,88 +227,104 @@ void WebAppManager::onApplicationClosed()
 
 void WebAppManager::killApp(const QString &appId)
 {
-    WebApplication *appToKill = 0;
-
-    Q_FOREACH(WebApplication *app, mApplications) {
-        if (app->id() == appId) {
-            appToKill = app;
-            break;
-        }
-    }
-
-    if (appToKill)
+    Q_FOREACH(WebApplication *appToKill, mApplications.findAllByAppId(appId))
         appToKill->kill();
 }
 
 void WebAppManager::killApp(int64_t processId)
 {
-    WebApplication *appToKill = 0;
-
-    Q_FOREACH(WebApplication *app, mApplications) {
-        if (app->processId() == processId) {
-            appToKill = app;
-            break;
-        }
-    }
-
+    WebApplication *appToKill = mApplications.findByProcessId(processId);
     if (appToKill)
         appToKill->kill();
 }
 
 bool WebAppManager::isAppRunning(const QString &appId)
 {
-    return mApplications.contains(appId);
+    Q_FOREACH(WebApplication *app, mApplications.findAllByAppId(appId)) {
+        if (!app->prelaunched())
+            return true;
+    }
+
+    return false;
 }
 
 QList<WebApplication*> WebAppManager::applications() const
 {
-    return mApplications.values();
+    return mApplications.applications();
 }
 
-bool WebAppManager::relaunch(const QString &appId, const QString &params)
+WebApplication* WebAppManager::applicationByProcessId(int64_t processId) const
 {
-    WebApplication *targetApp = 0;
+    return mApplications.findByProcessId(processId);
+}
 
-    Q_FOREACH(WebApplication *app, mApplications) {
-        if (app->id() == appId) {
-            targetApp = app;
-            break;
-        }
-    }
+WebApplication* WebAppManager::applicationByAppId(const QString &appId) const
+{
+    return mApplications.findByAppId(appId);
+}
 
-    if (!targetApp)
-        return false;
+bool WebAppManager::relaunch(const QString &appId, const QString &params)
+{
+    bool relaunched = false;
 
-    targetApp->relaunch(params);
+    Q_FOREACH(WebApplication *targetApp, mApplications.findAllByAppId(appId)) {
+        if (targetApp->prelaunched())
+            continue;
 
-    return true;
+        targetApp->relaunch(params);
+        relaunched = true;
+    }
+
+    return relaunched;
 }
 
 void WebAppManager::clearMemoryCaches()
 {
-    Q_FOREACH(WebApplication *app, mApplications) {
+    // We're asked to free memory so the applications nobody asked for are
+    // the first to go
+    mPrelauncher->discardAll();
+
+    Q_FOREACH(WebApplication *app, mApplications.applications()) {
         app->clearMemoryCaches();
     }
 }
 
 void WebAppManager::clearMemoryCaches(qint64 processId)
 {
-    Q_FOREACH(WebApplication *app, mApplications) {
-        if (app->processId() == processId) {
-            app->clearMemoryCaches();
-            break;
-        }
-    }
+    WebApplication *app = mApplications.findByProcessId(processId);
+    if (app)
+        app->clearMemoryCaches();
 }
 
 void WebAppManager::clearMemoryCaches(const QString& appId)
 {
-    Q_FOREACH(WebApplication *app, mApplications) {
-        if (app->id() == appId) {
-            app->clearMemoryCaches();
-            break;
-        }
-    }
+    Q_FOREACH(WebApplication *app, mApplications.findAllByAppId(appId))
+        app->clearMemoryCaches();
+}
+
+WebAppManagerService* WebAppManager::service() const
+{
+    return mService;
+}
+
+WindowPool* WebAppManager::windowPool() const
+{
+    return mWindowPool;
+}
+
+SpareWebProcess* WebAppManager::spareWebProcess() const
+{
+    return mSpareWebProcess;
+}
+
+LaunchScheduler* WebAppManager::launchScheduler() const
+{
+    return mLaunchScheduler;
+}
+
+Prelauncher* WebAppManager::prelauncher() const
+{
+    return mPrelauncher;
 }
 
 } // namespace luna
@@ -27,24 +27,33 @@
 #include <QTextStream>
 #include <QStringList>
 
+#include "applicationdescriptioncache.h"
+#include "launchrequest.h"
+#include "applicationregistry.h"
+#include "webapplication.h"
+
 namespace luna
 {
 
-class ApplicationDescription;
-class WebApplication;
 class WebAppManagerService;
+class WindowPool;
+class SpareWebProcess;
+class LaunchScheduler;
+class Prelauncher;
 
 class WebAppManager : public QGuiApplication
 {
     Q_OBJECT
 
 public:
-    WebAppManager(int& argc, char **argv);
+    WebAppManager(int& argc, char **argv, bool registerOnBus = true);
     virtual ~WebAppManager();
 
-    WebApplication* launchApp(const QString &appDesc, const QString &parameters, int64_t processId);
-    WebApplication* launchUrl(const QUrl &url, const QString &windowType,
-                              const QString &appDesc, const QString &parameters, int64_t processId);
+    WebApplication* launchApp(const LaunchRequest &request, const ApplicationDescriptionPtr &desc);
+    WebApplication* launchUrl(const LaunchRequest &request, const ApplicationDescriptionPtr &desc);
+    WebApplication* prelaunchApp(const QString &appId, int64_t processId, bool hinted);
+
+    ApplicationDescriptionPtr lookupDescription(const LaunchRequest &request, bool &valid);
 
     bool isAppRunning(const QString& appId);
     void killApp(const QString& appId);
@@ -52,18 +61,38 @@ public:
     bool relaunch(const QString& appId, const QString& params);
 
     QList<WebApplication*> applications() const;
+    WebApplication* applicationByProcessId(int64_t processId) const;
+    WebApplication* applicationByAppId(const QString &appId) const;
 
     void clearMemoryCaches();
     void clearMemoryCaches(qint64 processId);
     void clearMemoryCaches(const QString& appId);
 
+    WebAppManagerService* service() const;
+    WindowPool* windowPool() const;
+    SpareWebProcess* spareWebProcess() const;
+    LaunchScheduler* launchScheduler() const;
+    Prelauncher* prelauncher() const;
+
+protected:
+    virtual WebApplication* createApplication(const QUrl &url, const QString &windowType,
+                                              const ApplicationDescription &desc,
+                                              const QJsonValue &parameters, int64_t processId,
+                                              const LaunchTimeline &timeline,
+                                              WebApplication::Prelaunch prelaunch);
+
 private Q_SLOTS:
     void onApplicationClosed();
     void onAboutToQuit();
 
 private:
     WebAppManagerService *mService;
-    QMap<QString,WebApplication*> mApplications;
+    WindowPool *mWindowPool;
+    SpareWebProcess *mSpareWebProcess;
+    LaunchScheduler *mLaunchScheduler;
+    Prelauncher *mPrelauncher;
+    ApplicationRegistry mApplications;
+    ApplicationDescriptionCache mDescriptionCache;
 
     bool validateApplication(const ApplicationDescription& desc);
 };
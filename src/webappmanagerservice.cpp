@@ -15,39 +15,192 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 
-#include <QJsonDocument>
 #include <QJsonObject>
-#include <QJsonArray>
+#include <QMutexLocker>
+#include <QScopedPointer>
 
 #include "utils.h"
 #include "webapplication.h"
 #include "webappmanager.h"
 #include "webappmanagerservice.h"
+#include "windowpool.h"
+#include "sparewebprocess.h"
+#include "launchtimeline.h"
+#include "launchscheduler.h"
+#include "launchrequest.h"
+#include "qmlcomponentcache.h"
+#include "prelauncher.h"
 #include "lunaserviceutils.h"
+#include "servicerequest.h"
+#include "jsonwriter.h"
+#include "launchresponder.h"
+#include "jsonreader.h"
 
 #define WEBAPPMANAGER_SERVICE_ID    "org.webosports.webappmanager"
 
+/* Number of application events kept around for subscribers which reconnect
+ * and want to know what they missed in the meantime. */
+#define APP_EVENT_JOURNAL_SIZE      64
+
+/* Milliseconds a launchApp call waits for the application to reach the phase
+ * it should respond on before it gives up. */
+#define LAUNCH_RESPONSE_DEFAULT_TIMEOUT     10000
+
 namespace luna
 {
 
+/*
+ * Schemas of the parameters of our methods. They're compiled once when the
+ * service is created and every request is checked against them while it's
+ * parsed. Additional properties are allowed so callers passing more than we
+ * need keep working.
+ *
+ * There are no schemas for responses: they're written as text by JsonWriter
+ * and never pass through pbnjson, so there's no serialization step a schema
+ * could be applied to without parsing every response again.
+ */
+static const struct {
+    const char *method;
+    const char *schema;
+} methodSchemas[] = {
+    { "launchApp",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"appDesc\":{\"type\":\"object\"},"
+      "\"processId\":{\"type\":[\"number\",\"string\"]},"
+      "\"respondOn\":{\"enum\":[\"created\",\"loaded\",\"ready\"]},"
+      "\"timeout\":{\"type\":\"integer\"}},"
+      "\"required\":[\"appDesc\",\"processId\"]}" },
+    { "launchApps",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"apps\":{\"type\":\"array\",\"items\":{\"type\":\"object\"}}},"
+      "\"required\":[\"apps\"]}" },
+    { "launchUrl",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"url\":{\"type\":\"string\"},"
+      "\"processId\":{\"type\":[\"number\",\"string\"]},"
+      "\"windowType\":{\"type\":\"string\"}},"
+      "\"required\":[\"url\",\"processId\"]}" },
+    { "killApp",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"appId\":{\"type\":\"string\"},"
+      "\"processId\":{\"type\":[\"number\",\"string\"]}}}" },
+    { "isAppRunning",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"appId\":{\"type\":\"string\"}},"
+      "\"required\":[\"appId\"]}" },
+    { "listRunningApps",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"subscribe\":{\"type\":\"boolean\"}}}" },
+    { "registerForAppEvents",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"subscribe\":{\"type\":\"boolean\"},"
+      "\"appIds\":{\"type\":\"array\",\"items\":{\"type\":\"string\"}},"
+      "\"events\":{\"type\":\"array\",\"items\":{\"enum\":[\"start\",\"close\",\"fail\"]}},"
+      "\"since\":{\"type\":\"number\"}}}" },
+    { "relaunch",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"appId\":{\"type\":\"string\"},"
+      "\"params\":{\"type\":[\"string\",\"object\"]}},"
+      "\"required\":[\"appId\"]}" },
+    { "clearMemoryCaches",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"appId\":{\"type\":\"string\"},"
+      "\"processId\":{\"type\":[\"number\",\"string\"]}}}" },
+    { "getLaunchStats",
+      "{\"type\":\"object\"}" },
+    { "getLaunchTimings",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"appId\":{\"type\":\"string\"},"
+      "\"processId\":{\"type\":[\"number\",\"string\"]}}}" },
+    { "prelaunchHint",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"appDesc\":{\"type\":\"object\"}},"
+      "\"required\":[\"appDesc\"]}" },
+    { "cancelPrelaunch",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"appId\":{\"type\":\"string\"}},"
+      "\"required\":[\"appId\"]}" },
+    { "getServiceStats",
+      "{\"type\":\"object\",\"properties\":{"
+      "\"reset\":{\"type\":\"boolean\"}}}" },
+    { NULL, NULL }
+};
+
+/*
+ * Process ids are numbers in our responses. Before requests were checked
+ * against schemas a process id of any type was accepted, so one passed as a
+ * string still is and it's parsed as a number.
+ */
+static int64_t processIdParameter(const JsonReader &reader)
+{
+    if (reader.isString("processId"))
+        return reader.string("processId").toLongLong();
+
+    return reader.integer("processId");
+}
+
 /*! \page org_webosports_webappmanager Service API org.webosports.webappmanager
  *
  * Public methods:
  * - \ref org_webosports_webappmanager_launch_app
+ * - \ref org_webosports_webappmanager_launch_apps
  * - \ref org_webosports_webappmanager_launch_url
  * - \ref org_webosports_webappmanager_kill_app
  * - \ref org_webosports_webappmanager_is_app_running
  * - \ref org_webosports_webappmanager_list_running_apps
+ * - \ref org_webosports_webappmanager_register_for_app_events
+ * - \ref org_webosports_webappmanager_get_launch_stats
+ * - \ref org_webosports_webappmanager_get_launch_timings
+ * - \ref org_webosports_webappmanager_prelaunch_hint
+ * - \ref org_webosports_webappmanager_cancel_prelaunch
+ * - \ref org_webosports_webappmanager_get_service_stats
  */
 
-WebAppManagerService::WebAppManagerService(WebAppManager *webAppManager)
-    : LS::Handle(LS::registerService(WEBAPPMANAGER_SERVICE_ID, false)),
-      mWebAppManager(webAppManager)
+WebAppManagerService::WebAppManagerService(WebAppManager *webAppManager, bool registerOnBus)
+    : LS::Handle(registerOnBus ? LS::registerService(WEBAPPMANAGER_SERVICE_ID, false) : LS::Handle()),
+      mWebAppManager(webAppManager),
+      mServiceContext(g_main_context_new()),
+      mServiceLoop(g_main_loop_new(mServiceContext, FALSE)),
+      mServiceThread(0),
+      mAppEventSequence(0),
+      mAppEventFlushSource(0),
+      mAppEventPruneSource(0),
+      mRunningAppsSequence(0)
 {
-    attachToLoop(g_main_loop_new(g_main_context_default(), FALSE));
+    // Handlers for the methods which can also be called in process
+    mHandlers.insert("launchApp", &WebAppManagerService::handleLaunchApp);
+    mHandlers.insert("launchApps", &WebAppManagerService::handleLaunchApps);
+    mHandlers.insert("launchUrl", &WebAppManagerService::handleLaunchUrl);
+    mHandlers.insert("killApp", &WebAppManagerService::handleKillApp);
+    mHandlers.insert("isAppRunning", &WebAppManagerService::handleIsAppRunning);
+    mHandlers.insert("listRunningApps", &WebAppManagerService::handleListRunningApps);
+    mHandlers.insert("relaunch", &WebAppManagerService::handleRelaunch);
+    mHandlers.insert("clearMemoryCaches", &WebAppManagerService::handleClearMemoryCaches);
+    mHandlers.insert("getLaunchStats", &WebAppManagerService::handleGetLaunchStats);
+    mHandlers.insert("getLaunchTimings", &WebAppManagerService::handleGetLaunchTimings);
+    mHandlers.insert("prelaunchHint", &WebAppManagerService::handlePrelaunchHint);
+    mHandlers.insert("cancelPrelaunch", &WebAppManagerService::handleCancelPrelaunch);
+
+    for (int n = 0; methodSchemas[n].method; n++)
+        luna_service_schema_register(methodSchemas[n].method, methodSchemas[n].schema);
+
+    publishSnapshot();
+
+    if (registerOnBus)
+        registerMethods();
+
+    // Everything the service thread needs is set up so it can start
+    // receiving requests now
+    mServiceThread = g_thread_new("luna-service", runServiceThread, this);
+}
+
+void WebAppManagerService::registerMethods()
+{
+    attachToLoop(mServiceLoop);
 
     LS_CATEGORY_BEGIN(WebAppManagerService, "/")
         LS_CATEGORY_METHOD(launchApp)
+        LS_CATEGORY_METHOD(launchApps)
         LS_CATEGORY_METHOD(launchUrl)
         LS_CATEGORY_METHOD(killApp)
         LS_CATEGORY_METHOD(isAppRunning)
@@ -55,13 +208,241 @@ WebAppManagerService::WebAppManagerService(WebAppManager *webAppManager)
         LS_CATEGORY_METHOD(registerForAppEvents)
         LS_CATEGORY_METHOD(relaunch)
         LS_CATEGORY_METHOD(clearMemoryCaches)
+        LS_CATEGORY_METHOD(getLaunchStats)
+        LS_CATEGORY_METHOD(getLaunchTimings)
+        LS_CATEGORY_METHOD(prelaunchHint)
+        LS_CATEGORY_METHOD(cancelPrelaunch)
+        LS_CATEGORY_METHOD(getServiceStats)
     LS_CATEGORY_END
 
-    mAppEventSubscriptions.setServiceHandle(this);
+    mRunningAppsSubscriptions.setServiceHandle(this);
+
+    LSError lserror;
+    LSErrorInit(&lserror);
+
+    // Told about every canceled call so filters of registerForAppEvents
+    // nobody is subscribed to anymore can be dropped
+    if (!LSCallCancelNotificationAdd(get(), onSubscriptionCanceled, this, &lserror)) {
+        LSErrorPrint(&lserror, stderr);
+        LSErrorFree(&lserror);
+    }
 }
 
 WebAppManagerService::~WebAppManagerService()
 {
+    g_main_loop_quit(mServiceLoop);
+    g_thread_join(mServiceThread);
+
+    if (mAppEventFlushSource) {
+        g_source_destroy(mAppEventFlushSource);
+        g_source_unref(mAppEventFlushSource);
+    }
+
+    if (mAppEventPruneSource) {
+        g_source_destroy(mAppEventPruneSource);
+        g_source_unref(mAppEventPruneSource);
+    }
+
+    Q_FOREACH(const AppEventFilter &filter, mAppEventSubscriptions)
+        delete filter.subscriptions;
+
+    luna_service_schema_release_all();
+
+    // The bus connection keeps its own reference on the context until it's
+    // detached
+    g_main_loop_unref(mServiceLoop);
+    g_main_context_unref(mServiceContext);
+}
+
+gpointer WebAppManagerService::runServiceThread(gpointer data)
+{
+    WebAppManagerService *service = static_cast<WebAppManagerService*>(data);
+
+    g_main_context_push_thread_default(service->mServiceContext);
+    g_main_loop_run(service->mServiceLoop);
+    g_main_context_pop_thread_default(service->mServiceContext);
+
+    return NULL;
+}
+
+static gboolean runInvocation(gpointer data)
+{
+    std::function<void ()> *call = static_cast<std::function<void ()>*>(data);
+    (*call)();
+    return FALSE;
+}
+
+static void destroyInvocation(gpointer data)
+{
+    delete static_cast<std::function<void ()>*>(data);
+}
+
+void WebAppManagerService::invoke(GMainContext *context, const std::function<void ()> &call)
+{
+    // Calls from other threads are queued by glib and run in order by the
+    // thread running the context
+    g_main_context_invoke_full(context, G_PRIORITY_DEFAULT, runInvocation,
+                               new std::function<void ()>(call), destroyInvocation);
+}
+
+void WebAppManagerService::call(const QString &method, ServiceRequest *request)
+{
+    // Handled on the service thread like a request received from the bus;
+    // the request is ours and is gone once the handler returned
+    invoke(mServiceContext, [this, method, request] () {
+        QScopedPointer<ServiceRequest> scopedRequest(request);
+
+        Handler handler = mHandlers.value(method);
+        if (!handler) {
+            request->respond("{\"returnValue\":false,\"errorText\":\"Unknown method\"}");
+            return;
+        }
+
+        JsonReader root;
+        if (!validate(method.toUtf8().constData(), *request, root))
+            return;
+
+        (this->*handler)(*request, root);
+    });
+}
+
+bool WebAppManagerService::validate(const char *method, ServiceRequest &request, JsonReader &root)
+{
+    // The payload is checked against the schema while pbnjson builds its DOM
+    // and the handlers read their parameters from that DOM, so it's parsed
+    // only once
+    jvalue_ref parsed = luna_service_message_parse_and_validate_method(method, request.getPayload());
+    if (parsed) {
+        root = JsonReader(parsed);
+        if (root.isValid())
+            return true;
+    }
+
+    request.respond("{\"returnValue\":false,\"errorText\":\"Invalid parameters\"}");
+
+    return false;
+}
+
+bool WebAppManagerService::dispatch(LSMessage &message, Handler handler)
+{
+    // Requests record themselves in the statistics once they're responded to
+    LunaServiceRequest request(&message, &mStats);
+    JsonReader root;
+    if (!validate(request.method(), request, root))
+        return true;
+
+    return (this->*handler)(request, root);
+}
+
+bool WebAppManagerService::dispatch(LSMessage &message, LunaHandler handler)
+{
+    LunaServiceRequest request(&message, &mStats);
+    JsonReader root;
+    if (!validate(request.method(), request, root))
+        return true;
+
+    return (this->*handler)(request, root);
+}
+
+void WebAppManagerService::forwardToMainThread(ServiceRequest &request, const MainThreadCall &call)
+{
+    // The call is made on the main thread but its response is sent from the
+    // service thread which owns the bus connection and the statistics
+    QSharedPointer<ServiceRequest> deferred(request.defer());
+    if (!deferred) {
+        request.respond("{\"returnValue\":false,\"errorText\":\"Internal error\"}");
+        return;
+    }
+
+    ForwardedServiceRequest::Responder responder = [this, deferred] (const QByteArray &response) {
+        invoke(mServiceContext, [deferred, response] () {
+            deferred->respond(response.constData());
+        });
+    };
+
+    invoke(g_main_context_default(), [call, responder] () {
+        ForwardedServiceRequest forwardedRequest(responder);
+        call(forwardedRequest);
+    });
+}
+
+bool WebAppManagerService::launchApp(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handleLaunchApp);
+}
+
+bool WebAppManagerService::launchApps(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handleLaunchApps);
+}
+
+bool WebAppManagerService::launchUrl(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handleLaunchUrl);
+}
+
+bool WebAppManagerService::killApp(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handleKillApp);
+}
+
+bool WebAppManagerService::isAppRunning(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handleIsAppRunning);
+}
+
+bool WebAppManagerService::listRunningApps(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handleListRunningAppsOnBus);
+}
+
+bool WebAppManagerService::handleListRunningAppsOnBus(LunaServiceRequest &request, const JsonReader &root)
+{
+    // Subscriptions only exist on the bus so they're handled here while
+    // everything else goes through the common handler
+    if (!request.message().isSubscription())
+        return handleListRunningApps(request, root);
+
+    mRunningAppsSubscriptions.subscribe(request.message());
+
+    request.respond(snapshot()->runningApps.constData());
+
+    return true;
+}
+
+bool WebAppManagerService::relaunch(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handleRelaunch);
+}
+
+bool WebAppManagerService::clearMemoryCaches(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handleClearMemoryCaches);
+}
+
+bool WebAppManagerService::getLaunchStats(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handleGetLaunchStats);
+}
+
+bool WebAppManagerService::getLaunchTimings(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handleGetLaunchTimings);
+}
+
+bool WebAppManagerService::prelaunchHint(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handlePrelaunchHint);
+}
+
+bool WebAppManagerService::cancelPrelaunch(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handleCancelPrelaunch);
+}
+
+bool WebAppManagerService::getServiceStats(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handleGetServiceStats);
 }
 
 /*!
@@ -79,39 +460,54 @@ Launch an web application.
 \code
 {
     "appDesc": string,
+    "processId": number,
     "params": string,
     "launchingAppId": string,
-    "launchingProcId": string
+    "launchingProcId": string,
+    "respondOn": string,
+    "timeout": number
 }
 \endcode
 
 \param appDesc Application description
+\param processId Id of the process the application is launched for. A string holding a
+number is accepted as well.
 \param params Application parameters
 \param launchingAppId Application id of the application launching the new one
+\param respondOn When to respond: "created" as soon as the application exists (the
+default), "loaded" once its page finished loading or "ready" once it called stageReady.
+Queued launches are always responded to right away.
+\param timeout Milliseconds to wait for respondOn before failing. Defaults to 10000. A page
+which fails to load fails the call right away.
 
 \subsection org_webosports_webappmanager_launch_app_returns Returns:
 \code
 {
     "returnValue": boolean,
     "errorText": string,
-    "processId": string
+    "processId": number,
+    "queued": boolean
 }
 \endcode
 
 \param returnValue Indicates if the call was successful.
 \param errorText Describes the error if call was not successful.
 \param processId Id of the new application process
+\param queued Set when the launch of a headless or boot time application was deferred to
+not block foreground applications, or when the application is still loading and gets the
+parameters once it's loaded. A queued launch which fails later on is reported with a
+"fail" event to registerForAppEvents subscribers.
 
 \subsection org_webosports_webappmanager_launch_app_examples Examples:
 \code
-luna-send -n 1 luna-send -n 1 palm://org.webosports.webappmanager/launchApp '{"appDesc":{"title":"Memos","icon":"","noWindow":false,"main":"/usr/palm/applications/org.webosports.app.memos/index.html","id":"org.webosports.app.memos"}}'
+luna-send -n 1 luna-send -n 1 palm://org.webosports.webappmanager/launchApp '{"appDesc":{"title":"Memos","icon":"","noWindow":false,"main":"/usr/palm/applications/org.webosports.app.memos/index.html","id":"org.webosports.app.memos"},"processId":1001}'
 \endcode
 
 Example response of a successful call:
 \code
 {
     "returnValue": true,
-    "processId": "1001"
+    "processId": 1001
 }
 \endcode
 
@@ -123,287 +519,1221 @@ Example response for a failed call:
 }
 \endcode
 */
-bool WebAppManagerService::launchApp(LSMessage &message)
+bool WebAppManagerService::handleLaunchApp(ServiceRequest &request, const JsonReader &root)
 {
-    LS::Message request(&message);
+    qint64 receivedAt = LaunchTimeline::now();
 
-    QByteArray payload(request.getPayload());
-    if (payload.isEmpty()) {
-        request.respond("{\"returnValue\":false,\"errorText\":\"Bad JSON\"}");
+    if (!root.isObject("appDesc")) {
+        request.respond("{\"returnValue\":false,\"errorText\":\"No application description provided\"}");
         return true;
     }
 
-    QJsonDocument requestDocument = QJsonDocument::fromJson(payload);
-    if (!requestDocument.isObject()) {
-        request.respond("{\"returnValue\":false,\"errorText\":\"Bad JSON\"}");
+    if (!root.contains("processId")) {
+        request.respond("{\"returnValue\":false,\"errorText\":\"No process id provided\"}");
         return true;
     }
 
-    QJsonObject rootObject = requestDocument.object();
-    if (!(rootObject.contains("appDesc") && rootObject.value("appDesc").isObject())) {
-        request.respond("{\"returnValue\":false,\"errorText\":\"No application description provided\"}");
-        return true;
-    }
+    // Parameters are either passed as object or as an already serialized string
+    QJsonValue params(QString(""));
+    if (root.isObject("params") || root.isString("params"))
+        params = root.value("params");
 
-    if (!rootObject.contains("processId")) {
-        request.respond("{\"returnValue\":false,\"errorText\":\"No process id provided\"}");
+    LaunchResponder::RespondOn respondOn = LaunchResponder::RespondOnCreated;
+    if (root.contains("respondOn") &&
+        !LaunchResponder::parseRespondOn(root.string("respondOn"), respondOn)) {
+        request.respond("{\"returnValue\":false,\"errorText\":\"Invalid respondOn value\"}");
         return true;
     }
 
-    QString appDesc = jsonObjectToString(rootObject.value("appDesc").toObject());
-    QString params = "";
+    int timeout = root.integer("timeout", LAUNCH_RESPONSE_DEFAULT_TIMEOUT);
 
-    if (rootObject.contains("params")) {
-        if (rootObject.value("params").isObject())
-            params = jsonObjectToString(rootObject.value("params").toObject());
-        else
-            params = rootObject.value("params").toString();
-    }
+    LaunchRequest launchRequest(root.object("appDesc"), params,
+                                processIdParameter(root));
+    launchRequest.setReceivedAt(receivedAt);
 
-    int processId = rootObject.value("processId").toInt();
+    forwardToMainThread(request, [this, launchRequest, respondOn, timeout] (ServiceRequest &request) {
+        submitLaunch(request, launchRequest, respondOn, timeout);
+    });
 
-    WebApplication *app = mWebAppManager->launchApp(appDesc, params, processId);
+    return true;
+}
 
-    QJsonObject response;
+void WebAppManagerService::submitLaunch(ServiceRequest &request, const LaunchRequest &launchRequest,
+                                        LaunchResponder::RespondOn respondOn, int timeout)
+{
+    int64_t processId = 0;
+    LaunchScheduler::Result result = mWebAppManager->launchScheduler()->submit(launchRequest,
+                                                        LaunchScheduler::LaunchTypeApp, processId);
+
+    // Queued launches don't have an application yet to wait for so they're
+    // always answered right away
+    if (result == LaunchScheduler::ResultLaunched && respondOn != LaunchResponder::RespondOnCreated) {
+        WebApplication *app = mWebAppManager->applicationByProcessId(processId);
+        ServiceRequest *deferredRequest = app ? request.defer() : 0;
+        if (deferredRequest) {
+            new LaunchResponder(deferredRequest, app, respondOn, timeout, mWebAppManager);
+            return;
+        }
+    }
 
-    response.insert("returnValue", QJsonValue(app != 0));
+    respondLaunchResult(request, result, processId);
+}
 
-    if (!app)
-        response.insert("errorText", QJsonValue(QString("Failed to launch application")));
-    else
-        response.insert("processId", QJsonValue((qint64) app->processId()));
+/*!
+\page org_webosports_webappmanager
+\n
+\section org_webosports_webappmanager_launch_apps launchApps
 
-    response.insert("returnValue", QJsonValue(app != 0));
+\e Private
 
-    QJsonDocument responseDocument(response);
+org.webosports.webappmanager/launchApps
 
-    request.respond(responseDocument.toJson().constData());
+Launch several web applications at once, for example all services started at
+boot or all cards of a restored session. All descriptions are validated
+first. Applications which are already running are relaunched right away while
+all others are queued with headless ones first and only a limited number of
+them loading at the same time.
 
-    return true;
+\subsection org_webosports_webappmanager_launch_apps_syntax Syntax:
+\code
+{
+    "apps": [
+        {
+            "appDesc": object,
+            "params": string,
+            "processId": number
+        }
+    ]
 }
+\endcode
 
-bool WebAppManagerService::launchUrl(LSMessage &message)
+\param apps Applications to launch, each with the same parameters as for launchApp.
+
+\subsection org_webosports_webappmanager_launch_apps_returns Returns:
+\code
 {
-    LS::Message request(&message);
+    "returnValue": boolean,
+    "errorText": string,
+    "apps": [
+        {
+            "appId": string,
+            "returnValue": boolean,
+            "errorText": string,
+            "processId": number,
+            "queued": boolean
+        }
+    ]
+}
+\endcode
 
-    QByteArray payload(request.getPayload());
-    if (payload.isEmpty()) {
-        request.respond("{\"returnValue\":false,\"errorText\":\"Bad JSON\"}");
-        return true;
-    }
+\param returnValue Indicates if the request itself was valid.
+\param errorText Describes the error if call was not successful.
+\param apps Result of every application in the order they were passed.
+*/
+bool WebAppManagerService::handleLaunchApps(ServiceRequest &request, const JsonReader &root)
+{
+    qint64 receivedAt = LaunchTimeline::now();
 
-    QJsonDocument requestDocument = QJsonDocument::fromJson(payload);
-    if (!requestDocument.isObject()) {
-        request.respond("{\"returnValue\":false,\"errorText\":\"Bad JSON\"}");
+    if (!root.isArray("apps")) {
+        request.respond("{\"returnValue\":false,\"errorText\":\"No applications provided\"}");
         return true;
     }
 
-    QJsonObject rootObject = requestDocument.object();
+    QList<LaunchRequest> launchRequests;
+    QList<QJsonValue> appIds;
+    QStringList errors;
 
-    if (!(rootObject.contains("url") && rootObject.value("url").isString())) {
-        request.respond("{\"returnValue\":false,\"errorText\":\"No URL to launch provided\"}");
-        return true;
-    }
+    Q_FOREACH(const JsonReader &app, root.objects("apps")) {
+        QString error;
+        if (!app.isObject("appDesc"))
+            error = "No application description provided";
+        else if (!app.contains("processId"))
+            error = "No process id provided";
+        errors.append(error);
 
-    if (!rootObject.contains("processId")) {
-        request.respond("{\"returnValue\":false,\"errorText\":\"No process id provided\"}");
-        return true;
-    }
+        // The id is only needed to report the error, all others get it from
+        // the scheduler
+        appIds.append(error.isEmpty() ? QJsonValue() : app.object("appDesc").value("id"));
 
-    QUrl url(rootObject.value("url").toString());
+        if (!error.isEmpty())
+            continue;
 
-    QString windowType = "card";
-    if (rootObject.contains("windowType") && rootObject.value("windowType").isString())
-        windowType = rootObject.value("windowType").toString();
+        QJsonValue params(QString(""));
+        if (app.isObject("params") || app.isString("params"))
+            params = app.value("params");
 
-    QString appDesc = "";
-    if (rootObject.contains("appDesc") && rootObject.value("appDesc").isObject())
-        appDesc = jsonObjectToString(rootObject.value("appDesc").toObject());
+        LaunchRequest launchRequest(app.object("appDesc"), params,
+                                    processIdParameter(app));
+        launchRequest.setReceivedAt(receivedAt);
 
-    QString params = "";
-    if (rootObject.contains("params") && rootObject.value("params").isObject())
-        params = jsonObjectToString(rootObject.value("params").toObject());
+        launchRequests.append(launchRequest);
+    }
+
+    forwardToMainThread(request, [this, launchRequests, appIds, errors] (ServiceRequest &request) {
+        submitLaunches(request, launchRequests, appIds, errors);
+    });
 
-    int processId = rootObject.value("processId").toInt();
+    return true;
+}
 
-    WebApplication *app = mWebAppManager->launchUrl(url, windowType, appDesc, params, processId);
+void WebAppManagerService::submitLaunches(ServiceRequest &request, const QList<LaunchRequest> &launchRequests,
+                                          const QList<QJsonValue> &appIds, const QStringList &errors)
+{
+    QList<LaunchScheduler::BatchResult> results =
+        mWebAppManager->launchScheduler()->submitBatch(launchRequests);
+
+    mResponseWriter.clear();
+    mResponseWriter.beginObject();
+    mResponseWriter.insert("returnValue", true);
+    mResponseWriter.beginArray("apps");
+
+    int next = 0;
+    for (int n = 0; n < errors.count(); n++) {
+        mResponseWriter.beginObject();
+
+        if (!errors[n].isEmpty()) {
+            mResponseWriter.insert("appId", appIds[n]);
+            mResponseWriter.insert("returnValue", false);
+            mResponseWriter.insert("errorText", errors[n]);
+            mResponseWriter.endObject();
+            continue;
+        }
 
-    QJsonObject response;
+        const LaunchScheduler::BatchResult &result = results[next++];
 
-    response.insert("returnValue", QJsonValue(app != 0));
+        mResponseWriter.insert("appId", result.appId);
+        mResponseWriter.insert("returnValue", result.result != LaunchScheduler::ResultFailed);
 
-    if (!app)
-        response.insert("errorText", QJsonValue(QString("Failed to launch application")));
-    else
-        response.insert("processId", QJsonValue((qint64) app->processId()));
+        if (result.result == LaunchScheduler::ResultFailed)
+            mResponseWriter.insert("errorText", "Failed to launch application");
+        else
+            mResponseWriter.insert("processId", (qint64) result.processId);
 
-    response.insert("returnValue", QJsonValue(app != 0));
+        if (result.result == LaunchScheduler::ResultQueued || result.result == LaunchScheduler::ResultCoalesced)
+            mResponseWriter.insert("queued", true);
 
-    QJsonDocument responseDocument(response);
+        mResponseWriter.endObject();
+    }
 
-    request.respond(responseDocument.toJson().constData());
+    mResponseWriter.endArray();
+    mResponseWriter.endObject();
 
-    return true;
+    request.respond(mResponseWriter.constData());
 }
 
-bool WebAppManagerService::killApp(LSMessage &message)
+void WebAppManagerService::respondLaunchResult(ServiceRequest &request, LaunchScheduler::Result result,
+                                               int64_t processId)
 {
-    LS::Message request(&message);
+    mResponseWriter.clear();
+    mResponseWriter.beginObject();
 
-    QJsonDocument document = QJsonDocument::fromJson(request.getPayload());
+    mResponseWriter.insert("returnValue", result != LaunchScheduler::ResultFailed);
 
-    QJsonObject root = document.object();
+    if (result == LaunchScheduler::ResultFailed)
+        mResponseWriter.insert("errorText", "Failed to launch application");
+    else
+        mResponseWriter.insert("processId", (qint64) processId);
 
-    if (root.contains("processId")) {
-        int64_t processId = root.value("processId").toInt();
-        mWebAppManager->killApp(processId);
-    }
-    else if (root.contains("appId")) {
-        QString appId = root.value("appId").toString();
-        mWebAppManager->killApp(appId);
-    }
-    else {
-        request.respond("\"returnValue\":false,\"errorText\":\"Missing appId or processId parameter\"}");
-        return true;
-    }
+    if (result == LaunchScheduler::ResultQueued || result == LaunchScheduler::ResultCoalesced)
+        mResponseWriter.insert("queued", true);
 
-    request.respond("{\"returnValue\":true}");
+    mResponseWriter.endObject();
 
-    return true;
+    request.respond(mResponseWriter.constData());
 }
 
-bool WebAppManagerService::listRunningApps(LSMessage &message)
+bool WebAppManagerService::handleLaunchUrl(ServiceRequest &request, const JsonReader &root)
 {
-    LS::Message request(&message);
+    qint64 receivedAt = LaunchTimeline::now();
 
-    QJsonObject rootObj;
+    if (!root.isString("url")) {
+        request.respond("{\"returnValue\":false,\"errorText\":\"No URL to launch provided\"}");
+        return true;
+    }
 
-    QJsonArray runningApps;
-    Q_FOREACH(WebApplication *app, mWebAppManager->applications()) {
-        QJsonObject appObj;
-        appObj.insert("appId", app->id());
-        appObj.insert("processId", (qint64) app->processId());
-        runningApps.append(QJsonValue(appObj));
+    if (!root.contains("processId")) {
+        request.respond("{\"returnValue\":false,\"errorText\":\"No process id provided\"}");
+        return true;
     }
 
-    rootObj.insert("apps", runningApps);
+    QJsonValue params(QString(""));
+    if (root.isObject("params"))
+        params = root.value("params");
+
+    LaunchRequest launchRequest(root.object("appDesc"), params,
+                                processIdParameter(root));
+    launchRequest.setReceivedAt(receivedAt);
 
-    QJsonDocument document(rootObj);
+    launchRequest.setUrl(QUrl(root.string("url")));
 
-    request.respond(document.toJson().constData());
+    if (root.isString("windowType"))
+        launchRequest.setWindowType(root.string("windowType"));
+
+    forwardToMainThread(request, [this, launchRequest] (ServiceRequest &request) {
+        int64_t processId = 0;
+        LaunchScheduler::Result result = mWebAppManager->launchScheduler()->submit(launchRequest,
+                                                            LaunchScheduler::LaunchTypeUrl, processId);
+
+        respondLaunchResult(request, result, processId);
+    });
 
     return true;
 }
 
-bool WebAppManagerService::isAppRunning(LSMessage &message)
+bool WebAppManagerService::handleKillApp(ServiceRequest &request, const JsonReader &root)
 {
-    LS::Message request(&message);
-
-    QJsonDocument document = QJsonDocument::fromJson(QByteArray(request.getPayload()));
+    if (root.contains("processId")) {
+        int64_t processId = processIdParameter(root);
+        forwardToMainThread(request, [this, processId] (ServiceRequest &request) {
+            mWebAppManager->killApp(processId);
+            request.respond("{\"returnValue\":true}");
+        });
+    }
+    else if (root.contains("appId")) {
+        QString appId = root.string("appId");
+        forwardToMainThread(request, [this, appId] (ServiceRequest &request) {
+            mWebAppManager->killApp(appId);
+            request.respond("{\"returnValue\":true}");
+        });
+    }
+    else {
+        request.respond("{\"returnValue\":false,\"errorText\":\"Missing appId or processId parameter\"}");
+    }
 
-    QJsonObject root = document.object();
+    return true;
+}
 
-    if (!root.contains("appId")) {
-        request.respond("{\"returnValue\":false,\"errorText\":\"Missing appId parameter\"}");
-        return true;
-    }
+/*!
+\page org_webosports_webappmanager
+\n
+\section org_webosports_webappmanager_list_running_apps listRunningApps
 
-    QString appId = root.value("appId").toString();
+\e Private
 
-    bool running = mWebAppManager->isAppRunning(appId);
-    QString response = QString("{\"returnValue\":true,\"running\":%1}").arg(running ? "true" : "false");
+org.webosports.webappmanager/listRunningApps
 
-    request.respond(response.toUtf8().constData());
+List all running applications. When called with subscribe set the complete
+list is only sent once; afterwards every started or closed application is
+sent as a single change.
 
-    return true;
+\subsection org_webosports_webappmanager_list_running_apps_syntax Syntax:
+\code
+{
+    "subscribe": boolean
 }
+\endcode
 
-bool WebAppManagerService::registerForAppEvents(LSMessage &message)
+\param subscribe Receive changes of the list instead of polling it.
+
+\subsection org_webosports_webappmanager_list_running_apps_returns Returns:
+\code
 {
-    LS::Message request(&message);
+    "returnValue": boolean,
+    "sequence": number,
+    "apps": [
+        {
+            "appId": string,
+            "processId": number
+        }
+    ]
+}
+\endcode
 
-    if (!request.isSubscription()) {
-        request.respond("{\"returnValue\":false,\"errorText\":\"You can only subscribe to this method\"}");
-        return true;
-    }
+\param returnValue Indicates if the call was successful.
+\param sequence Number of the last change included in the list.
+\param apps All running applications.
+
+Changes sent to subscribers:
+\code
+{
+    "returnValue": true,
+    "sequence": number,
+    "added": { "appId": string, "processId": number },
+    "removed": { "appId": string, "processId": number }
+}
+\endcode
 
-    mAppEventSubscriptions.subscribe(request);
+\param sequence Increases by one with every change. A subscriber seeing a gap
+missed a change and has to request the complete list again. Changes with a
+sequence not higher than the one of the complete list are already included in
+it and can be ignored.
+\param added Application which was started. Only present if one was started.
+\param removed Application which was closed. Only present if one was closed.
+*/
+bool WebAppManagerService::handleListRunningApps(ServiceRequest &request, const JsonReader &root)
+{
+    Q_UNUSED(root);
 
-    request.respond("{\"returnValue\":true}");
+    request.respond(snapshot()->runningApps.constData());
 
     return true;
 }
 
-void WebAppManagerService::notifyAppHasStarted(const QString &appId, int64_t processId)
+void WebAppManagerService::publishSnapshot()
 {
-    QString payload = QString("{\"event\":\"start\",\"appId\":\"%1\",\"processId\":%2}")
-                        .arg(appId)
-                        .arg(processId);
+    // The list only changes when an application starts or closes so it's
+    // serialized once then and not for every request
+    RegistrySnapshot *snapshot = new RegistrySnapshot;
 
-    mAppEventSubscriptions.post(payload.toUtf8().constData());
-}
+    mSnapshotWriter.clear();
+    mSnapshotWriter.beginObject();
+    mSnapshotWriter.insert("returnValue", true);
+    mSnapshotWriter.insert("sequence", (qint64) mRunningAppsSequence);
 
-void WebAppManagerService::notifyAppHasFinished(const QString &appId, int64_t processId)
-{
-    QString payload = QString("{\"event\":\"close\",\"appId\":\"%1\",\"processId\":%2}")
-                        .arg(appId)
-                        .arg(processId);
+    mSnapshotWriter.beginArray("apps");
+    Q_FOREACH(WebApplication *app, mWebAppManager->applications()) {
+        if (app->prelaunched())
+            continue;
 
-    mAppEventSubscriptions.post(payload.toUtf8().constData());
+        mSnapshotWriter.beginObject();
+        mSnapshotWriter.insert("appId", app->id());
+        mSnapshotWriter.insert("processId", (qint64) app->processId());
+        mSnapshotWriter.endObject();
+
+        snapshot->runningAppIds.insert(app->id());
+    }
+    mSnapshotWriter.endArray();
+
+    mSnapshotWriter.endObject();
+
+    snapshot->runningApps = mSnapshotWriter.data();
+
+    QSharedPointer<const RegistrySnapshot> published(snapshot);
+
+    // Readers only hold the lock to take a reference so the old snapshot is
+    // released outside of it
+    QMutexLocker locker(&mSnapshotLock);
+    mSnapshot.swap(published);
 }
 
-bool WebAppManagerService::relaunch(LSMessage &message)
+QSharedPointer<const WebAppManagerService::RegistrySnapshot> WebAppManagerService::snapshot() const
 {
-    LS::Message request(&message);
-
-    QJsonDocument document = QJsonDocument::fromJson(QByteArray(request.getPayload()));
+    QMutexLocker locker(&mSnapshotLock);
+    return mSnapshot;
+}
 
-    QJsonObject root = document.object();
+void WebAppManagerService::postRunningAppsChange(const char *change, const QString &appId,
+                                                 int64_t processId)
+{
+    mRunningAppsSequence++;
+
+    publishSnapshot();
+
+    mSnapshotWriter.clear();
+    mSnapshotWriter.beginObject();
+    mSnapshotWriter.insert("returnValue", true);
+    mSnapshotWriter.insert("sequence", (qint64) mRunningAppsSequence);
+    mSnapshotWriter.beginObject(change);
+    mSnapshotWriter.insert("appId", appId);
+    mSnapshotWriter.insert("processId", (qint64) processId);
+    mSnapshotWriter.endObject();
+    mSnapshotWriter.endObject();
+
+    QByteArray delta = mSnapshotWriter.data();
+    invoke(mServiceContext, [this, delta] () {
+        mRunningAppsSubscriptions.post(delta.constData());
+    });
+}
 
+bool WebAppManagerService::handleIsAppRunning(ServiceRequest &request, const JsonReader &root)
+{
     if (!root.contains("appId")) {
         request.respond("{\"returnValue\":false,\"errorText\":\"Missing appId parameter\"}");
         return true;
     }
 
-    QString appId = root.value("appId").toString();
+    QString appId = root.string("appId");
 
-    QString params = "{}";
-    if (root.contains("params") && root.value("params").isString())
-        params = root.value("params").toString();
+    bool running = snapshot()->runningAppIds.contains(appId);
 
-    bool success = mWebAppManager->relaunch(appId, params);
-    if (!success)
-        request.respond("{\"returnValue\":false,\"errorText\":\"Failed to relaunch application\"}");
-    else
-        request.respond("{\"returnValue\":true}");
+    request.respond(running ? "{\"returnValue\":true,\"running\":true}" :
+                              "{\"returnValue\":true,\"running\":false}");
 
     return true;
 }
 
-bool WebAppManagerService::clearMemoryCaches(LSMessage &message)
+/*!
+\page org_webosports_webappmanager
+\n
+\section org_webosports_webappmanager_register_for_app_events registerForAppEvents
+
+\e Private
+
+org.webosports.webappmanager/registerForAppEvents
+
+Subscribe to applications being started and closed. All events which happen
+at the same time are sent together.
+
+\subsection org_webosports_webappmanager_register_for_app_events_syntax Syntax:
+\code
+{
+    "subscribe": true,
+    "appIds": [ string ],
+    "events": [ string ],
+    "since": number
+}
+\endcode
+
+\param appIds Only send events of these applications. All applications if not set.
+\param events Only send these events, "start", "close" or "fail". All events if not set.
+A "fail" event is sent when a launch which was queued failed; its caller was only told
+it was queued.
+\param since Sequence number of the last event the subscriber has seen. All
+later events still known are sent with the first response.
+
+\subsection org_webosports_webappmanager_register_for_app_events_returns Returns:
+\code
+{
+    "returnValue": boolean,
+    "errorText": string,
+    "sequence": number,
+    "complete": boolean,
+    "events": [
+        {
+            "sequence": number,
+            "event": string,
+            "appId": string,
+            "processId": number
+        }
+    ]
+}
+\endcode
+
+\param returnValue Indicates if the call was successful.
+\param errorText Describes the error if call was not successful.
+\param sequence Sequence number of the last event which happened so far.
+\param complete Only in the first response if since was passed. False when
+events newer than since aren't known anymore, or since is newer than the last
+event because the service was restarted, and the subscriber has to assume it
+missed some.
+\param events Events which happened, oldest first.
+*/
+bool WebAppManagerService::registerForAppEvents(LSMessage &message)
+{
+    return dispatch(message, &WebAppManagerService::handleRegisterForAppEvents);
+}
+
+bool WebAppManagerService::handleRegisterForAppEvents(LunaServiceRequest &request, const JsonReader &root)
+{
+    if (!request.message().isSubscription()) {
+        request.respond("{\"returnValue\":false,\"errorText\":\"You can only subscribe to this method\"}");
+        return true;
+    }
+
+    AppEventFilter filter;
+    filter.subscriptions = 0;
+    filter.subscribers = 0;
+    filter.appIds = root.stringList("appIds");
+    filter.events = root.stringList("events");
+
+    filter.appIds.sort();
+    filter.appIds.removeDuplicates();
+    filter.events.sort();
+    filter.events.removeDuplicates();
+
+    // Subscribers with the same filter share one subscription point so every
+    // batch is only filtered and serialized once per distinct filter
+    QString key = filter.appIds.join(",") + "|" + filter.events.join(",");
+    if (!mAppEventSubscriptions.contains(key)) {
+        filter.subscriptions = new LS::SubscriptionPoint;
+        filter.subscriptions->setServiceHandle(this);
+        mAppEventSubscriptions.insert(key, filter);
+    }
+
+    // Nothing queued may reach the new subscriber twice, with the replay
+    // below and with the next batch
+    flushAppEvents();
+
+    AppEventFilter &subscribed = mAppEventSubscriptions[key];
+    if (subscribed.subscriptions->subscribe(request.message())) {
+        subscribed.subscribers++;
+        mAppEventSubscribers.insert(LSMessageGetUniqueToken(request.message().get()), key);
+    }
+    filter = subscribed;
+
+    mBusWriter.clear();
+    mBusWriter.beginObject();
+    mBusWriter.insert("returnValue", true);
+    mBusWriter.insert("sequence", (qint64) mAppEventSequence);
+
+    if (root.contains("since")) {
+        quint64 since = (quint64) root.integer("since");
+
+        QList<AppEvent> missed;
+        Q_FOREACH(const AppEvent &event, mAppEventJournal) {
+            if (event.sequence > since)
+                missed.append(event);
+        }
+
+        // A since beyond the last event was handed out before we were
+        // restarted and started counting again, so what happened since then
+        // isn't known
+        bool complete = since == mAppEventSequence ||
+                        (since < mAppEventSequence && !mAppEventJournal.isEmpty() &&
+                         mAppEventJournal.first().sequence <= since + 1);
+
+        mBusWriter.insert("complete", complete);
+        writeAppEvents(mBusWriter, missed, filter);
+    }
+
+    mBusWriter.endObject();
+
+    request.respond(mBusWriter.constData());
+
+    return true;
+}
+
+bool WebAppManagerService::AppEventFilter::matches(const AppEvent &event) const
+{
+    if (!appIds.isEmpty() && !appIds.contains(event.appId))
+        return false;
+
+    if (!events.isEmpty() && !events.contains(event.event))
+        return false;
+
+    return true;
+}
+
+int WebAppManagerService::writeAppEvents(JsonWriter &writer, const QList<AppEvent> &events,
+                                         const AppEventFilter &filter)
+{
+    int count = 0;
+
+    writer.beginArray("events");
+    Q_FOREACH(const AppEvent &event, events) {
+        if (!filter.matches(event))
+            continue;
+
+        writer.beginObject();
+        writer.insert("sequence", (qint64) event.sequence);
+        writer.insert("event", event.event);
+        writer.insert("appId", event.appId);
+        writer.insert("processId", (qint64) event.processId);
+        writer.endObject();
+
+        count++;
+    }
+    writer.endArray();
+
+    return count;
+}
+
+void WebAppManagerService::queueAppEvent(const QString &event, const QString &appId, int64_t processId)
+{
+    AppEvent appEvent;
+    appEvent.sequence = ++mAppEventSequence;
+    appEvent.event = event;
+    appEvent.appId = appId;
+    appEvent.processId = processId;
+
+    mAppEventJournal.append(appEvent);
+    while (mAppEventJournal.count() > APP_EVENT_JOURNAL_SIZE)
+        mAppEventJournal.removeFirst();
+
+    mPendingAppEvents.append(appEvent);
+
+    // All events queued until the service thread is idle again are sent to
+    // the subscribers at once
+    if (!mAppEventFlushSource) {
+        mAppEventFlushSource = g_idle_source_new();
+        g_source_set_callback(mAppEventFlushSource, onFlushAppEvents, this, NULL);
+        g_source_attach(mAppEventFlushSource, mServiceContext);
+    }
+}
+
+gboolean WebAppManagerService::onFlushAppEvents(gpointer data)
+{
+    WebAppManagerService *service = static_cast<WebAppManagerService*>(data);
+    service->flushAppEvents();
+
+    return FALSE;
+}
+
+void WebAppManagerService::flushAppEvents()
+{
+    if (mAppEventFlushSource) {
+        g_source_destroy(mAppEventFlushSource);
+        g_source_unref(mAppEventFlushSource);
+        mAppEventFlushSource = 0;
+    }
+
+    if (mPendingAppEvents.isEmpty())
+        return;
+
+    Q_FOREACH(const AppEventFilter &filter, mAppEventSubscriptions) {
+        mEventWriter.clear();
+        mEventWriter.beginObject();
+        mEventWriter.insert("returnValue", true);
+        mEventWriter.insert("sequence", (qint64) mAppEventSequence);
+        int count = writeAppEvents(mEventWriter, mPendingAppEvents, filter);
+        mEventWriter.endObject();
+
+        if (count > 0)
+            filter.subscriptions->post(mEventWriter.constData());
+    }
+
+    mPendingAppEvents.clear();
+}
+
+bool WebAppManagerService::onSubscriptionCanceled(LSHandle *handle, const char *uniqueToken, void *data)
+{
+    Q_UNUSED(handle);
+
+    WebAppManagerService *service = static_cast<WebAppManagerService*>(data);
+
+    QString key = service->mAppEventSubscribers.take(uniqueToken);
+    if (key.isEmpty() || !service->mAppEventSubscriptions.contains(key))
+        return true;
+
+    AppEventFilter &filter = service->mAppEventSubscriptions[key];
+    if (--filter.subscribers > 0)
+        return true;
+
+    // The subscription point is told about the cancel as well, maybe only
+    // after us, so it's deleted once the service thread is idle again
+    if (!service->mAppEventPruneSource) {
+        service->mAppEventPruneSource = g_idle_source_new();
+        g_source_set_callback(service->mAppEventPruneSource, onPruneAppEventSubscriptions, service, NULL);
+        g_source_attach(service->mAppEventPruneSource, service->mServiceContext);
+    }
+
+    return true;
+}
+
+gboolean WebAppManagerService::onPruneAppEventSubscriptions(gpointer data)
+{
+    WebAppManagerService *service = static_cast<WebAppManagerService*>(data);
+    service->pruneAppEventSubscriptions();
+
+    return FALSE;
+}
+
+void WebAppManagerService::pruneAppEventSubscriptions()
+{
+    if (mAppEventPruneSource) {
+        g_source_destroy(mAppEventPruneSource);
+        g_source_unref(mAppEventPruneSource);
+        mAppEventPruneSource = 0;
+    }
+
+    // Filters somebody subscribed to again in the meantime are kept
+    QHash<QString, AppEventFilter>::iterator it = mAppEventSubscriptions.begin();
+    while (it != mAppEventSubscriptions.end()) {
+        if (it.value().subscribers > 0) {
+            ++it;
+            continue;
+        }
+
+        delete it.value().subscriptions;
+        it = mAppEventSubscriptions.erase(it);
+    }
+}
+
+void WebAppManagerService::notifyAppHasStarted(const QString &appId, int64_t processId)
+{
+    invoke(mServiceContext, [this, appId, processId] () {
+        queueAppEvent("start", appId, processId);
+    });
+
+    postRunningAppsChange("added", appId, processId);
+}
+
+void WebAppManagerService::notifyAppHasFinished(const QString &appId, int64_t processId)
 {
-    LS::Message request(&message);
+    invoke(mServiceContext, [this, appId, processId] () {
+        queueAppEvent("close", appId, processId);
+    });
+
+    postRunningAppsChange("removed", appId, processId);
+}
 
-    QJsonDocument document = QJsonDocument::fromJson(QByteArray(request.getPayload()));
+void WebAppManagerService::notifyAppLaunchFailed(const QString &appId, int64_t processId)
+{
+    // The application never ran so it isn't in the list of running ones
+    invoke(mServiceContext, [this, appId, processId] () {
+        queueAppEvent("fail", appId, processId);
+    });
+}
 
-    QJsonObject root = document.object();
+bool WebAppManagerService::handleRelaunch(ServiceRequest &request, const JsonReader &root)
+{
+    if (!root.contains("appId")) {
+        request.respond("{\"returnValue\":false,\"errorText\":\"Missing appId parameter\"}");
+        return true;
+    }
 
+    QString appId = root.string("appId");
+    QString params = "{}";
+    if (root.isString("params") || root.isObject("params"))
+        params = LaunchRequest::parametersToString(root.value("params"));
+
+    forwardToMainThread(request, [this, appId, params] (ServiceRequest &request) {
+        bool success = mWebAppManager->relaunch(appId, params);
+        if (!success)
+            request.respond("{\"returnValue\":false,\"errorText\":\"Failed to relaunch application\"}");
+        else
+            request.respond("{\"returnValue\":true}");
+    });
+
+    return true;
+}
+
+bool WebAppManagerService::handleClearMemoryCaches(ServiceRequest &request, const JsonReader &root)
+{
+    MainThreadCall call;
     if (!root.contains("appId") || !root.contains("processId")) {
         // If no appId or processId provided we clean the caches for all apps
-        mWebAppManager->clearMemoryCaches();
+        call = [this] (ServiceRequest &request) {
+            mWebAppManager->clearMemoryCaches();
+            request.respond("{\"returnValue\":true}");
+        };
     }
-    else {
-        if (root.contains("processId")) {
-            qint64 processId = root.value("processId").toInt();
+    else if (root.contains("processId")) {
+        qint64 processId = processIdParameter(root);
+        call = [this, processId] (ServiceRequest &request) {
             mWebAppManager->clearMemoryCaches(processId);
-        }
-        else if (root.contains("appId")) {
-            QString appId = root.value("appId").toString();
+            request.respond("{\"returnValue\":true}");
+        };
+    }
+    else {
+        QString appId = root.string("appId");
+        call = [this, appId] (ServiceRequest &request) {
             mWebAppManager->clearMemoryCaches(appId);
+            request.respond("{\"returnValue\":true}");
+        };
+    }
+
+    forwardToMainThread(request, call);
+
+    return true;
+}
+
+/*!
+\page org_webosports_webappmanager
+\n
+\section org_webosports_webappmanager_get_launch_stats getLaunchStats
+
+\e Private
+
+org.webosports.webappmanager/getLaunchStats
+
+Report how well the pre-created windows and the spare web process serve the
+launches seen so far and the state of the launch queue.
+
+\subsection org_webosports_webappmanager_get_launch_stats_returns Returns:
+\code
+{
+    "returnValue": true,
+    "windowPool": {
+        "size": number,
+        "available": number,
+        "sharedEngine": boolean
+    },
+    "spareWebProcess": {
+        "enabled": boolean,
+        "available": boolean,
+        "hits": number,
+        "misses": number,
+        "ageMs": number,
+        "averageAgeOnHitMs": number
+    },
+    "launchQueue": {
+        "depth": number,
+        "maxDepth": number,
+        "launched": number,
+        "coalesced": number,
+        "averageWaitMs": number,
+        "maxWaitMs": number,
+        "inFlight": number,
+        "maxConcurrentLaunches": number
+    },
+    "qmlComponentCache": {
+        "hits": number,
+        "misses": number
+    },
+    "prelaunch": {
+        "maxApplications": number,
+        "memoryBudgetMb": number,
+        "availableMemoryMb": number,
+        "active": number,
+        "prelaunched": number,
+        "hits": number,
+        "discarded": number,
+        "hitRate": number,
+        "hints": number,
+        "hintHits": number,
+        "predictions": [string]
+    }
+}
+\endcode
+
+\param ageMs Age of the currently waiting spare or -1 if there is none.
+\param averageAgeOnHitMs Average age of the spare at the time it was adopted.
+\param coalesced Number of launch requests merged into an already queued one.
+\param averageWaitMs Average time queued launches waited before they were started.
+\param inFlight Number of queued applications which were started and are still loading.
+\param maxConcurrentLaunches Number of queued applications allowed to load at the same time.
+\param misses For qmlComponentCache the number of components which had to be compiled.
+\param active Number of prelaunched applications currently waiting to be adopted.
+\param hitRate Share of the prelaunched applications which were adopted by a launch
+instead of being discarded again.
+\param hintHits Number of prelaunchHint calls which were followed by a launch of the
+hinted application.
+\param predictions Applications expected to be launched next.
+*/
+bool WebAppManagerService::handleGetLaunchStats(ServiceRequest &request, const JsonReader &root)
+{
+    Q_UNUSED(root);
+
+    // All of this is live state of objects owned by the main thread which
+    // changes all the time, like the age of the spare web process or the
+    // queue, so it isn't worth publishing with every change for a call only
+    // used for diagnostics
+    forwardToMainThread(request, [this] (ServiceRequest &request) {
+        respondLaunchStats(request);
+    });
+
+    return true;
+}
+
+void WebAppManagerService::respondLaunchStats(ServiceRequest &request)
+{
+    WindowPool *windowPool = mWebAppManager->windowPool();
+    SpareWebProcess *spare = mWebAppManager->spareWebProcess();
+
+    LaunchScheduler *scheduler = mWebAppManager->launchScheduler();
+    Prelauncher *prelauncher = mWebAppManager->prelauncher();
+
+    mResponseWriter.clear();
+    mResponseWriter.beginObject();
+    mResponseWriter.insert("returnValue", true);
+
+    mResponseWriter.beginObject("windowPool");
+    mResponseWriter.insert("size", windowPool->size());
+    mResponseWriter.insert("available", windowPool->available());
+    mResponseWriter.insert("sharedEngine", windowPool->sharedEngine() != 0);
+    mResponseWriter.endObject();
+
+    mResponseWriter.beginObject("spareWebProcess");
+    mResponseWriter.insert("enabled", spare->enabled());
+    mResponseWriter.insert("available", spare->available());
+    mResponseWriter.insert("hits", spare->hits());
+    mResponseWriter.insert("misses", spare->misses());
+    mResponseWriter.insert("ageMs", spare->age());
+    mResponseWriter.insert("averageAgeOnHitMs", spare->averageAgeOnHit());
+    mResponseWriter.endObject();
+
+    mResponseWriter.beginObject("launchQueue");
+    mResponseWriter.insert("depth", scheduler->depth());
+    mResponseWriter.insert("maxDepth", scheduler->maxDepth());
+    mResponseWriter.insert("launched", scheduler->launched());
+    mResponseWriter.insert("coalesced", scheduler->coalesced());
+    mResponseWriter.insert("averageWaitMs", scheduler->averageWait());
+    mResponseWriter.insert("maxWaitMs", scheduler->maxWait());
+    mResponseWriter.insert("inFlight", scheduler->inFlight());
+    mResponseWriter.insert("maxConcurrentLaunches", scheduler->maxConcurrentLaunches());
+    mResponseWriter.endObject();
+
+    mResponseWriter.beginObject("qmlComponentCache");
+    mResponseWriter.insert("hits", QmlComponentCache::hits());
+    mResponseWriter.insert("misses", QmlComponentCache::misses());
+    mResponseWriter.endObject();
+
+    mResponseWriter.beginObject("prelaunch");
+    mResponseWriter.insert("maxApplications", prelauncher->maxApplications());
+    mResponseWriter.insert("memoryBudgetMb", prelauncher->memoryBudget());
+    mResponseWriter.insert("availableMemoryMb", Prelauncher::availableMemory());
+    mResponseWriter.insert("active", prelauncher->active());
+    mResponseWriter.insert("prelaunched", prelauncher->prelaunched());
+    mResponseWriter.insert("hits", prelauncher->hits());
+    mResponseWriter.insert("discarded", prelauncher->discarded());
+
+    int resolved = prelauncher->hits() + prelauncher->discarded();
+    mResponseWriter.insert("hitRate", resolved > 0 ? (double) prelauncher->hits() / resolved : 0.0);
+    mResponseWriter.insert("hints", prelauncher->hints());
+    mResponseWriter.insert("hintHits", prelauncher->hintHits());
+    mResponseWriter.insert("predictions", prelauncher->predictions());
+    mResponseWriter.endObject();
+
+    mResponseWriter.endObject();
+
+    request.respond(mResponseWriter.constData());
+}
+
+/*!
+\page org_webosports_webappmanager
+\n
+\section org_webosports_webappmanager_get_launch_timings getLaunchTimings
+
+\e Private
+
+org.webosports.webappmanager/getLaunchTimings
+
+Report the time the running applications needed to pass the different phases
+of their launch.
+
+\subsection org_webosports_webappmanager_get_launch_timings_syntax Syntax:
+\code
+{
+    "appId": string,
+    "processId": number
+}
+\endcode
+
+\param appId Only report the timings of the application with this id. Optional.
+\param processId Only report the timings of the application with this process id. Optional.
+
+\subsection org_webosports_webappmanager_get_launch_timings_returns Returns:
+\code
+{
+    "returnValue": true,
+    "apps": [
+        {
+            "appId": string,
+            "processId": number,
+            "timeline": {
+                "startedAt": number,
+                "phases": {
+                    "received": number,
+                    "descriptionParsed": number,
+                    "windowCreated": number,
+                    "containerLoaded": number,
+                    "webViewConfigured": number,
+                    "loadStarted": number,
+                    "loadSucceeded": number,
+                    "stageReady": number,
+                    "firstFrame": number
+                }
+            }
         }
+    ]
+}
+\endcode
+
+\param startedAt Monotonic timestamp in microseconds the launch request was received at.
+\param phases Milliseconds from receiving the launch request until the phase was reached.
+Phases not reached yet are omitted.
+*/
+bool WebAppManagerService::handleGetLaunchTimings(ServiceRequest &request, const JsonReader &root)
+{
+    QString appId = root.string("appId");
+    bool filterByProcessId = root.contains("processId");
+    int64_t processId = processIdParameter(root);
+
+    // The timelines are updated by the main thread with every phase an
+    // application passes, so publishing them would cost it a serialization
+    // per phase while they're only asked for when measuring launches
+    forwardToMainThread(request, [this, appId, filterByProcessId, processId] (ServiceRequest &request) {
+        respondLaunchTimings(request, appId, filterByProcessId, processId);
+    });
+
+    return true;
+}
+
+void WebAppManagerService::respondLaunchTimings(ServiceRequest &request, const QString &appId,
+                                                bool filterByProcessId, int64_t processId)
+{
+    mResponseWriter.clear();
+    mResponseWriter.beginObject();
+    mResponseWriter.insert("returnValue", true);
+
+    mResponseWriter.beginArray("apps");
+    Q_FOREACH(WebApplication *app, mWebAppManager->applications()) {
+        if (!appId.isEmpty() && appId != app->id())
+            continue;
+
+        if (filterByProcessId && processId != app->processId())
+            continue;
+
+        mResponseWriter.beginObject();
+        mResponseWriter.insert("appId", app->id());
+        mResponseWriter.insert("processId", (qint64) app->processId());
+        mResponseWriter.insert("timeline", QJsonValue(app->launchTimeline().toJson()));
+        mResponseWriter.endObject();
     }
+    mResponseWriter.endArray();
+
+    mResponseWriter.endObject();
+
+    request.respond(mResponseWriter.constData());
+}
+
+/*!
+\page org_webosports_webappmanager
+\n
+\section org_webosports_webappmanager_prelaunch_hint prelaunchHint
+
+\e Private
+
+org.webosports.webappmanager/prelaunchHint
+
+Tell the manager that an application is likely to be launched in a moment, for
+example because its icon was just touched. The application is started hidden
+right away and adopted by the following launchApp call. If no launch follows
+within a few seconds or cancelPrelaunch is called it's thrown away again. Only
+as many applications as the --prelaunch-count option allows are kept
+prelaunched; the oldest hinted one makes room for a new hint first.
+
+\subsection org_webosports_webappmanager_prelaunch_hint_syntax Syntax:
+\code
+{
+    "appDesc": object
+}
+\endcode
+
+\param appDesc Application description as passed to launchApp.
+
+\subsection org_webosports_webappmanager_prelaunch_hint_returns Returns:
+\code
+{
+    "returnValue": boolean,
+    "errorText": string
+}
+\endcode
+
+\param returnValue Indicates if the application is prelaunched or already running.
+\param errorText Describes the error if call was not successful.
+*/
+bool WebAppManagerService::handlePrelaunchHint(ServiceRequest &request, const JsonReader &root)
+{
+    if (!root.isObject("appDesc")) {
+        request.respond("{\"returnValue\":false,\"errorText\":\"No application description provided\"}");
+        return true;
+    }
+
+    // The description is found the same way as the one of a launch
+    LaunchRequest hintRequest(root.object("appDesc"), QJsonValue(), 0);
+
+    forwardToMainThread(request, [this, hintRequest] (ServiceRequest &request) {
+        // Parsing the description here already saves the launch from doing it
+        bool valid = false;
+        ApplicationDescriptionPtr desc = mWebAppManager->lookupDescription(hintRequest, valid);
+        if (!valid) {
+            request.respond("{\"returnValue\":false,\"errorText\":\"Invalid application description\"}");
+            return;
+        }
+
+        if (!mWebAppManager->prelauncher()->hint(desc->id())) {
+            request.respond("{\"returnValue\":false,\"errorText\":\"Application can't be prelaunched\"}");
+            return;
+        }
+
+        request.respond("{\"returnValue\":true}");
+    });
+
+    return true;
+}
+
+/*!
+\page org_webosports_webappmanager
+\n
+\section org_webosports_webappmanager_cancel_prelaunch cancelPrelaunch
+
+\e Private
+
+org.webosports.webappmanager/cancelPrelaunch
+
+Throw away an application prelaunched because of a prelaunchHint call as the
+launch won't happen anymore.
+
+\subsection org_webosports_webappmanager_cancel_prelaunch_syntax Syntax:
+\code
+{
+    "appId": string
+}
+\endcode
+
+\param appId Id of the application passed to prelaunchHint before.
+
+\subsection org_webosports_webappmanager_cancel_prelaunch_returns Returns:
+\code
+{
+    "returnValue": boolean,
+    "canceled": boolean
+}
+\endcode
+
+\param canceled Set if a hinted prelaunch of the application was thrown away.
+*/
+bool WebAppManagerService::handleCancelPrelaunch(ServiceRequest &request, const JsonReader &root)
+{
+    if (!root.contains("appId")) {
+        request.respond("{\"returnValue\":false,\"errorText\":\"Missing appId parameter\"}");
+        return true;
+    }
+
+    QString appId = root.string("appId");
+
+    // Not a query: the prelaunched application is torn down, which only the
+    // main thread can do
+    forwardToMainThread(request, [this, appId] (ServiceRequest &request) {
+        bool canceled = mWebAppManager->prelauncher()->cancel(appId);
+
+        request.respond(canceled ? "{\"returnValue\":true,\"canceled\":true}" :
+                                   "{\"returnValue\":true,\"canceled\":false}");
+    });
+
+    return true;
+}
+
+/*!
+\page org_webosports_webappmanager
+\n
+\section org_webosports_webappmanager_get_service_stats getServiceStats
+
+\e Private
+
+org.webosports.webappmanager/getServiceStats
+
+Report how often each method of the service was called over the bus and how
+long handling the calls took.
+
+\subsection org_webosports_webappmanager_get_service_stats_syntax Syntax:
+\code
+{
+    "reset": boolean
+}
+\endcode
+
+\param reset Start counting from zero again after the statistics were reported.
+
+\subsection org_webosports_webappmanager_get_service_stats_returns Returns:
+\code
+{
+    "returnValue": true,
+    "periodMs": number,
+    "methods": {
+        "<method>": {
+            "calls": number,
+            "errors": number,
+            "requestBytes": number,
+            "responseBytes": number,
+            "averageLatencyUs": number,
+            "maxLatencyUs": number,
+            "latencyHistogram": [number]
+        }
+    }
+}
+\endcode
+
+\param periodMs Milliseconds since the statistics were last reset.
+\param errors Number of calls which were answered with returnValue false.
+\param latencyHistogram Number of calls per latency bucket. The first bucket counts
+calls which took up to one microsecond, every following bucket calls which took
+between 2^n and 2^(n+1) microseconds. Empty buckets at the end are left out.
+*/
+bool WebAppManagerService::handleGetServiceStats(ServiceRequest &request, const JsonReader &root)
+{
+    mBusWriter.clear();
+    mBusWriter.beginObject();
+    mBusWriter.insert("returnValue", true);
+    mStats.write(mBusWriter);
+    mBusWriter.endObject();
+
+    request.respond(mBusWriter.constData());
 
-    request.respond("{\"returnValue\":true}");
+    if (root.boolean("reset"))
+        mStats.reset();
 
     return true;
 }
@@ -21,22 +21,120 @@
 #include <glib.h>
 #include <luna-service2/lunaservice.hpp>
 
+#include <QByteArray>
+#include <QHash>
+#include <QJsonValue>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+#include "jsonreader.h"
+#include "jsonwriter.h"
+#include "launchscheduler.h"
+#include "launchresponder.h"
+#include "servicestats.h"
+
 namespace luna
 {
 
 class WebAppManager;
+class ServiceRequest;
+class LunaServiceRequest;
 
+/*
+ * The bus is served from a thread of its own with its own main context so a
+ * busy main thread doesn't delay the answers to simple queries. Queries are
+ * answered there from a snapshot of the running applications which the main
+ * thread publishes whenever an application starts or closes. Every other
+ * request is decoded on the service thread as well and only what it asks for
+ * is handed to the main thread; the response is sent back to the service
+ * thread.
+ *
+ * Without registering on the bus the methods can only be called in process
+ * with call(), which is what the benchmarks do.
+ */
 class WebAppManagerService : private LS::Handle
 {
 public:
-    WebAppManagerService(WebAppManager *webAppManager);
+    WebAppManagerService(WebAppManager *webAppManager, bool registerOnBus = true);
     ~WebAppManagerService();
 
     void notifyAppHasStarted(const QString& appId, int64_t processId);
     void notifyAppHasFinished(const QString& appId, int64_t processId);
+    void notifyAppLaunchFailed(const QString& appId, int64_t processId);
+
+    void call(const QString &method, ServiceRequest *request);
 
 private:
+    typedef bool (WebAppManagerService::*Handler)(ServiceRequest &request, const JsonReader &root);
+    typedef bool (WebAppManagerService::*LunaHandler)(LunaServiceRequest &request,
+                                                     const JsonReader &root);
+    typedef std::function<void (ServiceRequest &request)> MainThreadCall;
+
+    struct AppEvent
+    {
+        quint64 sequence;
+        QString event;
+        QString appId;
+        int64_t processId;
+    };
+
+    struct AppEventFilter
+    {
+        QStringList appIds;
+        QStringList events;
+        LS::SubscriptionPoint *subscriptions;
+        int subscribers;
+
+        bool matches(const AppEvent &event) const;
+    };
+
+    struct RegistrySnapshot
+    {
+        QByteArray runningApps;
+        QSet<QString> runningAppIds;
+    };
+
+    void registerMethods();
+
+    bool dispatch(LSMessage &message, Handler handler);
+    bool dispatch(LSMessage &message, LunaHandler handler);
+    void forwardToMainThread(ServiceRequest &request, const MainThreadCall &call);
+    bool validate(const char *method, ServiceRequest &request, JsonReader &root);
+
+    static gpointer runServiceThread(gpointer data);
+    static void invoke(GMainContext *context, const std::function<void ()> &call);
+
+    void publishSnapshot();
+    QSharedPointer<const RegistrySnapshot> snapshot() const;
+    void postRunningAppsChange(const char *change, const QString &appId, int64_t processId);
+
+    void queueAppEvent(const QString &event, const QString &appId, int64_t processId);
+    void flushAppEvents();
+    static gboolean onFlushAppEvents(gpointer data);
+    void pruneAppEventSubscriptions();
+    static gboolean onPruneAppEventSubscriptions(gpointer data);
+    static bool onSubscriptionCanceled(LSHandle *handle, const char *uniqueToken, void *data);
+    static int writeAppEvents(JsonWriter &writer, const QList<AppEvent> &events,
+                              const AppEventFilter &filter);
+
+    void submitLaunch(ServiceRequest &request, const LaunchRequest &launchRequest,
+                      LaunchResponder::RespondOn respondOn, int timeout);
+    void submitLaunches(ServiceRequest &request, const QList<LaunchRequest> &launchRequests,
+                        const QList<QJsonValue> &appIds, const QStringList &errors);
+    void respondLaunchResult(ServiceRequest &request, LaunchScheduler::Result result,
+                             int64_t processId);
+    void respondLaunchStats(ServiceRequest &request);
+    void respondLaunchTimings(ServiceRequest &request, const QString &appId, bool filterByProcessId,
+                              int64_t processId);
+
     bool launchApp(LSMessage &message);
+    bool launchApps(LSMessage &message);
     bool launchUrl(LSMessage &message);
     bool killApp(LSMessage &message);
     bool isAppRunning(LSMessage &message);
@@ -44,10 +142,64 @@ private:
     bool registerForAppEvents(LSMessage &message);
     bool relaunch(LSMessage &message);
     bool clearMemoryCaches(LSMessage &message);
+    bool getLaunchStats(LSMessage &message);
+    bool getLaunchTimings(LSMessage &message);
+    bool prelaunchHint(LSMessage &message);
+    bool cancelPrelaunch(LSMessage &message);
+    bool getServiceStats(LSMessage &message);
+
+    bool handleLaunchApp(ServiceRequest &request, const JsonReader &root);
+    bool handleLaunchApps(ServiceRequest &request, const JsonReader &root);
+    bool handleLaunchUrl(ServiceRequest &request, const JsonReader &root);
+    bool handleKillApp(ServiceRequest &request, const JsonReader &root);
+    bool handleIsAppRunning(ServiceRequest &request, const JsonReader &root);
+    bool handleListRunningApps(ServiceRequest &request, const JsonReader &root);
+    bool handleRelaunch(ServiceRequest &request, const JsonReader &root);
+    bool handleClearMemoryCaches(ServiceRequest &request, const JsonReader &root);
+    bool handleGetLaunchStats(ServiceRequest &request, const JsonReader &root);
+    bool handleGetLaunchTimings(ServiceRequest &request, const JsonReader &root);
+    bool handlePrelaunchHint(ServiceRequest &request, const JsonReader &root);
+    bool handleCancelPrelaunch(ServiceRequest &request, const JsonReader &root);
+    bool handleGetServiceStats(ServiceRequest &request, const JsonReader &root);
+
+    bool handleListRunningAppsOnBus(LunaServiceRequest &request, const JsonReader &root);
+    bool handleRegisterForAppEvents(LunaServiceRequest &request, const JsonReader &root);
 
 private:
     WebAppManager *mWebAppManager;
-    LS::SubscriptionPoint mAppEventSubscriptions;
+
+    GMainContext *mServiceContext;
+    GMainLoop *mServiceLoop;
+    GThread *mServiceThread;
+
+    // Not changed after construction
+    QHash<QString, Handler> mHandlers;
+
+    // Owned by the service thread
+    QHash<QString, AppEventFilter> mAppEventSubscriptions;
+    QHash<QString, QString> mAppEventSubscribers;
+    GSource *mAppEventPruneSource;
+    QList<AppEvent> mAppEventJournal;
+    QList<AppEvent> mPendingAppEvents;
+    quint64 mAppEventSequence;
+    GSource *mAppEventFlushSource;
+    LS::SubscriptionPoint mRunningAppsSubscriptions;
+    ServiceStats mStats;
+
+    // Every thread reuses its own writers for responses and posted payloads
+    // so serializing them doesn't allocate once the buffers have grown to
+    // their typical size
+    JsonWriter mBusWriter;
+    JsonWriter mEventWriter;
+
+    // Owned by the main thread
+    quint64 mRunningAppsSequence;
+    JsonWriter mResponseWriter;
+    JsonWriter mSnapshotWriter;
+
+    // Replaced as a whole by the main thread and only read by the service thread
+    QSharedPointer<const RegistrySnapshot> mSnapshot;
+    mutable QMutex mSnapshotLock;
 };
 
 } // namespace luna
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDebug>
+#include <QQuickView>
+#include <QQmlComponent>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QGuiApplication>
+#include <QScreen>
+
+#include "windowpool.h"
+#include "qmlcomponentcache.h"
+#include "incubationcontroller.h"
+
+#define WINDOW_POOL_DEFAULT_SIZE        2
+
+/* Time to wait after a window was taken from the pool before we start to refill
+ * it. This gives the application which just got launched the chance to finish
+ * its startup before we compete with it on the main loop. */
+#define WINDOW_POOL_REFILL_DELAY        1500
+
+#define APPLICATION_CONTAINER_URL       "qrc:///qml/ApplicationContainer.qml"
+#define SPLASH_URL                      "qrc:///qml/Splash.qml"
+
+namespace luna
+{
+
+WindowPool::WindowPool(QObject *parent) :
+    QObject(parent),
+    mSize(WINDOW_POOL_DEFAULT_SIZE),
+    mRefillTimer(this),
+    mSharedEngine(0)
+{
+    connect(&mRefillTimer, SIGNAL(timeout()), this, SLOT(onRefillTimeout()));
+    mRefillTimer.setSingleShot(true);
+
+    scheduleRefill();
+}
+
+WindowPool::~WindowPool()
+{
+    Q_FOREACH(QQuickView *window, mWindows)
+        delete window;
+
+    mWindows.clear();
+}
+
+void WindowPool::setSize(int size)
+{
+    mSize = qMax(0, size);
+
+    while (mWindows.count() > mSize)
+        delete mWindows.takeLast();
+
+    scheduleRefill();
+}
+
+int WindowPool::size() const
+{
+    return mSize;
+}
+
+int WindowPool::available() const
+{
+    return mWindows.count();
+}
+
+QQuickView* WindowPool::take()
+{
+    scheduleRefill();
+
+    if (mWindows.isEmpty()) {
+        qDebug() << __PRETTY_FUNCTION__ << "No pre-created window available";
+        return 0;
+    }
+
+    return mWindows.takeFirst();
+}
+
+void WindowPool::setSharedEngineEnabled(bool enabled)
+{
+    if (enabled == (mSharedEngine != 0))
+        return;
+
+    // Windows in the pool were created for the other mode
+    Q_FOREACH(QQuickView *window, mWindows)
+        delete window;
+    mWindows.clear();
+
+    if (enabled) {
+        mSharedEngine = new QQmlEngine(this);
+        mSharedEngine->setIncubationController(new IncubationController(mSharedEngine));
+    }
+    else {
+        delete mSharedEngine;
+        mSharedEngine = 0;
+    }
+
+    scheduleRefill();
+}
+
+QQmlEngine* WindowPool::sharedEngine() const
+{
+    return mSharedEngine;
+}
+
+QQmlContext* WindowPool::contextForWindow(QQuickView *window) const
+{
+    if (!mSharedEngine)
+        return window->rootContext();
+
+    return window->findChild<QQmlContext*>(QString(), Qt::FindDirectChildrenOnly);
+}
+
+QObject* WindowPool::loadContainer(QQuickView *window)
+{
+    QUrl url(QString(APPLICATION_CONTAINER_URL));
+
+    // Normally the pool already compiled the container for the engine of this
+    // window so we only have to instantiate it
+    QQmlComponent *component = QmlComponentCache::component(window->engine(), url);
+    if (!component || !component->isReady()) {
+        qWarning() << "Failed to load application container";
+        return 0;
+    }
+
+    QObject *rootObject = component->create(contextForWindow(window));
+    window->setContent(url, component, rootObject);
+
+    return rootObject;
+}
+
+QQuickView* WindowPool::createWindow()
+{
+    QQuickView *window = 0;
+
+    if (mSharedEngine) {
+        window = new QQuickView(mSharedEngine, 0);
+
+        // every window gets its own context for the application specific
+        // properties; it's found again through contextForWindow
+        new QQmlContext(mSharedEngine->rootContext(), window);
+    }
+    else {
+        window = new QQuickView;
+
+        // Replace the controller of the view as that one only incubates while
+        // the window is rendering which our windows don't do before they're
+        // shown
+        window->engine()->setIncubationController(new IncubationController(window->engine()));
+    }
+
+    window->setColor(Qt::transparent);
+
+    window->reportContentOrientationChange(QGuiApplication::primaryScreen()->primaryOrientation());
+
+    window->setSurfaceType(QSurface::OpenGLSurface);
+    QSurfaceFormat surfaceFormat = window->format();
+    surfaceFormat.setAlphaBufferSize(8);
+    surfaceFormat.setRenderableType(QSurfaceFormat::OpenGLES);
+    window->setFormat(surfaceFormat);
+
+    // make sure the platform window gets created to be able to set it's
+    // window properties
+    window->create();
+
+    return window;
+}
+
+void WindowPool::scheduleRefill()
+{
+    if (mWindows.count() >= mSize || mRefillTimer.isActive())
+        return;
+
+    mRefillTimer.start(WINDOW_POOL_REFILL_DELAY);
+}
+
+void WindowPool::onRefillTimeout()
+{
+    if (mWindows.count() >= mSize)
+        return;
+
+    qDebug() << __PRETTY_FUNCTION__ << "Pre-creating window" << mWindows.count() + 1 << "of" << mSize;
+
+    QQuickView *window = createWindow();
+
+    // Compile the application container and the splash once so the engine has
+    // resolved all imports and the compiled components are ready to be
+    // instantiated. With a shared engine this only does something for the
+    // first window.
+    QmlComponentCache::component(window->engine(), QUrl(QString(APPLICATION_CONTAINER_URL)));
+    QmlComponentCache::component(window->engine(), QUrl(QString(SPLASH_URL)));
+
+    mWindows.append(window);
+
+    // only create one window per main loop iteration to not block any other
+    // application for too long
+    if (mWindows.count() < mSize)
+        mRefillTimer.start(0);
+}
+
+} // namespace luna
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2014 Simon Busch <morphis@gravedo.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef WINDOWPOOL_H
+#define WINDOWPOOL_H
+
+#include <QObject>
+#include <QList>
+#include <QTimer>
+
+class QQuickView;
+class QQmlContext;
+class QQmlEngine;
+
+namespace luna
+{
+
+/*
+ * Keeps a number of hidden, fully created application windows around so that
+ * launching a card doesn't have to pay for creating the platform window and
+ * compiling the application container on the critical path. The engine of each
+ * window already has ApplicationContainer.qml compiled and all of its imports
+ * resolved and keeps the component in the QmlComponentCache. The container itself is only instantiated once the window is bound
+ * to an application as it needs the webApp and webAppWindow context properties.
+ *
+ * When the shared engine is enabled all windows use one engine and every
+ * window gets its own context for the webApp and webAppWindow properties
+ * instead of setting them on the root context of a private engine.
+ */
+class WindowPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WindowPool(QObject *parent = 0);
+    ~WindowPool();
+
+    void setSize(int size);
+    int size() const;
+    int available() const;
+
+    QQuickView* take();
+    QQuickView* createWindow();
+
+    void setSharedEngineEnabled(bool enabled);
+    QQmlEngine* sharedEngine() const;
+
+    QQmlContext* contextForWindow(QQuickView *window) const;
+    QObject* loadContainer(QQuickView *window);
+
+private Q_SLOTS:
+    void onRefillTimeout();
+
+private:
+    int mSize;
+    QList<QQuickView*> mWindows;
+    QTimer mRefillTimer;
+    QQmlEngine *mSharedEngine;
+
+    void scheduleRefill();
+};
+
+} // namespace luna
+
+#endif // WINDOWPOOL_H